@@ -0,0 +1,60 @@
+/*
+ * BeatTrace.h
+ *
+ *  Description:
+ *  A recording of what the beat detectors see: every frame's FFT bands and the SDK's beat and onset flags,
+ *  with the true beats where they are known. Traces are text, one frame per line:
+ *
+ *      TRACE isBeat isOnset truth band0 band1 ...
+ *
+ *  truth is 1 on a frame with a real beat, 0 without and -1 when it is not known. DancingTiles logs these
+ *  lines when built with TRACE_BEATS, so a plugin log from a real install can be replayed as is; lines
+ *  that do not start with TRACE are skipped. Synthetic traces with known beats can be generated too.
+ *  Lines starting with "# " are notes about the trace (where it came from, what to replay it on); they are
+ *  kept in notes and written out first.
+ */
+
+#ifndef INC_BEATTRACE_H_
+#define INC_BEATTRACE_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+typedef struct {
+    bool isBeat;
+    bool isOnset;
+    int truth;
+    std::vector<uint8_t> bins;
+} trace_frame_t;
+
+class BeatTrace {
+public:
+    BeatTrace();
+
+    /** @description: read a trace, or the TRACE lines out of a plugin log. false if nothing was read */
+    bool load(const char* path);
+
+    bool save(const char* path) const;
+
+    /**
+     * @description: make up a trace with a kick and snare pattern over noise, plus a loud sustained
+     * section in the middle that has no beats. The SDK flags are the true beats with some misses, jitter
+     * and false alarms, the onsets also fire on hi-hats.
+     * @param nFrames: length, at 20 frames a second
+     * @param nBands: number of FFT bands
+     * @param bpm: tempo
+     * @param noise: largest background value in a band
+     * @param seed: for the random numbers
+     */
+    void synthesize(int nFrames, int nBands, float bpm, int noise, unsigned seed);
+
+    /** @description: true if every frame knows whether it had a beat */
+    bool hasTruth() const;
+
+    int nBands;
+    std::vector<trace_frame_t> frames;
+    std::vector<std::string> notes;     // without the "# " and the newline
+};
+
+#endif /* INC_BEATTRACE_H_ */
@@ -0,0 +1,50 @@
+/*
+ * BenchPlugin.h
+ *
+ *  Description:
+ *  What every bench that runs plugins needs: the list of plugins the makefile builds, where a plugin named
+ *  on the command line is found, its entry points out of the .so, and a clock.
+ */
+
+#ifndef INC_BENCHPLUGIN_H_
+#define INC_BENCHPLUGIN_H_
+
+#include "AuroraPlugin.h"
+#include <string>
+#include <vector>
+
+typedef void (*init_function_t)(void);
+typedef void (*frame_function_t)(Frame_t* frames, int* nFrames, int* sleepTime);
+typedef void (*cleanup_function_t)(void);
+
+typedef struct {
+    void* handle;
+    init_function_t initPlugin;
+    frame_function_t getPluginFrame;
+    cleanup_function_t pluginCleanup;
+} bench_plugin_t;
+
+/** @description: every plugin the makefile builds (its PLUGINS), the default when none are named */
+std::vector<std::string> benchDefaultPlugins();
+
+/**
+ * @description: where a plugin is
+ * @param name: a plugin name or a path to a .so, which is taken as is
+ * @param dir: the directory built plugins are in, plugins/ or plugins/cov/
+ */
+std::string benchPluginPath(const std::string& name, const char* dir = "plugins");
+
+/**
+ * @description: dlopen a plugin and look up its entry points
+ * @param error: why it couldn't be loaded
+ * @return: false if it can't be loaded or is missing an entry point
+ */
+bool loadPlugin(const std::string& path, bench_plugin_t* plugin, std::string* error);
+
+/** @description: dlclose a loaded plugin */
+void unloadPlugin(bench_plugin_t* plugin);
+
+/** @description: monotonic time in seconds */
+double benchSeconds();
+
+#endif /* INC_BENCHPLUGIN_H_ */
@@ -0,0 +1,99 @@
+/*
+ * HostSdk.h
+ *
+ *  Description:
+ *  A stand in for the Aurora SDK library so the plugins can be built for and run on the host: the
+ *  DataManager, PluginFeatures, ColorUtils and layout functions the plugins call, made up layouts of any
+ *  size and a palette. Plugins built as shared objects pick these up from the bench program that loads them
+ *  (link it with -rdynamic).
+ *
+ *  It also keeps the books on what the plugin costs while the bench runs it. Wall time and heap allocations
+ *  (operator new) are charged to the phase the plugin is in:
+ *
+ *      plugin      the plugin's own code, i.e. everything not below
+ *      layout      inside getLayoutData, which hands out a freshly parsed LayoutData like the SDK does
+ *      palette     inside getColorPalette
+ *      logging     inside printf and friends; the output goes to a sink instead of the terminal
+ *      features    inside the enable* calls
+ *      detect, spawn,  stretches of the plugin's own code it marks with hostMarkPhase, so far only
+ *      render, write   DancingTiles's (see DancingTiles/inc/PhaseMarks.h)
+ *
+ *  Only the thread that called hostResetStats is accounted; allocations on other threads still show in
+ *  hostLiveBytes. Since printf is taken over the bench itself has to print with fprintf.
+ */
+
+#ifndef INC_HOSTSDK_H_
+#define INC_HOSTSDK_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define HOST_SIDE_LENGTH 150        // panel side length of the made up layouts
+#define HOST_PALETTE_SIZE 7
+#define HOST_FFT_BINS 64            // most bins a plugin can ask for
+
+typedef enum {
+    HOST_PHASE_PLUGIN = 0,
+    HOST_PHASE_LAYOUT,
+    HOST_PHASE_PALETTE,
+    HOST_PHASE_LOGGING,
+    HOST_PHASE_FEATURES,
+    HOST_PHASE_DETECT,      // the marked phases, in the order of hostMarkPhase's marks
+    HOST_PHASE_SPAWN,
+    HOST_PHASE_RENDER,
+    HOST_PHASE_WRITE,
+    HOST_PHASES
+} host_phase_t;
+
+typedef struct {
+    double seconds;
+    long allocations;
+    long bytes;
+} host_phase_stats_t;
+
+/**
+ * @description: make up the layout getLayoutData will hand out: a connected blob of triangles grown at
+ * random from one panel, the same blob every time for the same seed
+ */
+void hostMakeLayout(int nPanels, unsigned seed);
+
+/** @description: free the LayoutData handed out since the last call, the next getLayoutData parses a new one */
+void hostFreeLayout();
+
+/**
+ * @description: the sound the plugin hears on its next frame
+ * @param bins: FFT bins, getEnergy is their sum
+ * @param isBeat, isOnset: what getIsBeat and getIsOnset return
+ */
+void hostSetAudio(const uint8_t* bins, int nBins, bool isBeat, bool isOnset);
+
+/** @description: where the plugin's log lines go, /dev/null unless set */
+void hostSetLogSink(FILE* sink);
+
+/** @description: zero the phase books and start charging the calling thread to HOST_PHASE_PLUGIN */
+void hostResetStats();
+
+/** @description: the books since hostResetStats, one entry per phase */
+void hostStats(host_phase_stats_t* stats);
+
+/**
+ * @description: have a function called on the measured thread every time it moves from one phase to another,
+ * for finer books than the time and allocations kept here (e.g. hardware counters)
+ * @param hook: gets the phase the stretch since the previous call (or hostResetStats) belongs to, NULL for none
+ */
+typedef void (*host_phase_hook_t)(int phase);
+void hostSetPhaseHook(host_phase_hook_t hook);
+
+/**
+ * @description: called by the plugin to charge its own code from here on to a marked phase, a no-op off
+ * the measured thread. Plugins declare it weak so they still load on the device, where nothing defines it.
+ * @param mark: 0 for the plugin again, 1 to 4 for detect, spawn, render and write
+ */
+extern "C" void hostMarkPhase(int mark);
+
+/** @description: bytes allocated with operator new and not deleted yet, on any thread */
+long hostLiveBytes();
+
+extern const char* hostPhaseNames[HOST_PHASES];
+
+#endif /* INC_HOSTSDK_H_ */
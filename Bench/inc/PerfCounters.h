@@ -0,0 +1,56 @@
+/*
+ * PerfCounters.h
+ *
+ *  Description:
+ *  The CPU's performance counters for the calling thread, through perf_event_open: cycles, instructions,
+ *  L1 data and last level cache misses and branch misses, plus the kernel's task clock and page faults.
+ *  Only user space is counted. Every counter is opened on its own, so on a machine (or in a container or
+ *  VM) that doesn't have some of them the rest still work; the ones missing are marked unavailable and
+ *  read as 0. When the kernel multiplexes counters the values are scaled up to the full time.
+ */
+
+#ifndef INC_PERFCOUNTERS_H_
+#define INC_PERFCOUNTERS_H_
+
+#include <stdint.h>
+
+typedef enum {
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_TASK_CLOCK,        // ns on the CPU
+    PERF_PAGE_FAULTS,
+    PERF_COUNTERS
+} perf_counter_t;
+
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    /**
+     * @description: open every counter and start them
+     * @return: the number that could be opened
+     */
+    int open();
+
+    void close();
+
+    /** @description: the counts so far, unavailable counters read 0 */
+    void read(uint64_t* values) const;
+
+    bool available(int counter) const { return fds[counter] >= 0; }
+
+    /** @description: why the first counter that couldn't be opened couldn't be, NULL if they all could */
+    const char* unavailableReason() const { return reason; }
+
+    static const char* name(int counter);
+
+private:
+    int fds[PERF_COUNTERS];
+    const char* reason;
+};
+
+#endif /* INC_PERFCOUNTERS_H_ */
@@ -0,0 +1,138 @@
+/*
+ * BeatSourceBench.cpp
+ *
+ *  Description:
+ *  Replays beat traces through each BeatSource mode and reports what it costs per frame and, where the
+ *  trace knows the real beats, how good the beats are.
+ *
+ *      beatSourceBench [trace ...]
+ *
+ *  With no traces it makes up a few (see BeatTrace::synthesize). A detected beat is a frame with at least
+ *  one band event and it matches a real beat up to BENCH_MATCH_FRAMES frames away.
+ */
+
+#include "BeatSource.h"
+#include "BeatQueue.h"
+#include "BeatTrace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+#define BENCH_MIN_FRAMES 2000000  // frames replayed for the timing, the trace is looped to get there
+#define BENCH_MATCH_FRAMES 1 // how far off a detected beat may be from the real one
+
+static const char* modeNames[] = {"sdk", "local", "fused"};
+
+static double seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** the frames with a band beat, one pass over the trace */
+static std::vector<bool> detectedFrames(const BeatTrace& trace, BeatSourceMode mode) {
+    BeatSource source;
+    BeatQueue queue;
+    beat_cursor_t cursor = queue.subscribe(false);
+    std::vector<bool> detected(trace.frames.size(), false);
+    source.init(trace.nBands, mode);
+    for(size_t f = 0; f < trace.frames.size(); f++) {
+        const trace_frame_t& frame = trace.frames[f];
+        source.detect(&frame.bins[0], frame.isBeat, frame.isOnset, f, &queue);
+        beat_event_t event;
+        while(queue.poll(&cursor, &event)) {
+            detected[f] = detected[f] || event.band != BEAT_BAND_NONE;
+        }
+    }
+    return detected;
+}
+
+/** nanoseconds per frame of BeatSource::detect */
+static double timeFrames(const BeatTrace& trace, BeatSourceMode mode) {
+    BeatSource source;
+    BeatQueue queue;
+    source.init(trace.nBands, mode);
+    size_t n = trace.frames.size();
+    long frames = 0;
+    long events = 0;
+    double start = seconds();
+    while(frames < BENCH_MIN_FRAMES) {
+        for(size_t f = 0; f < n; f++) {
+            const trace_frame_t& frame = trace.frames[f];
+            events += source.detect(&frame.bins[0], frame.isBeat, frame.isOnset, frames++, &queue);
+        }
+    }
+    double elapsed = seconds() - start;
+    if(events < 0) {
+        printf("\n");  // keeps the loop from being optimized away
+    }
+    return elapsed * 1e9 / frames;
+}
+
+/** match detected beats to real ones, greedily, each real beat at most once */
+static void score(const BeatTrace& trace, const std::vector<bool>& detected, int* hits, int* nDetected, int* nTrue) {
+    int n = trace.frames.size();
+    std::vector<bool> used(n, false);
+    *hits = *nDetected = *nTrue = 0;
+    for(int f = 0; f < n; f++) {
+        *nTrue += trace.frames[f].truth > 0;
+        if(!detected[f]) {
+            continue;
+        }
+        (*nDetected)++;
+        for(int g = f - BENCH_MATCH_FRAMES; g <= f + BENCH_MATCH_FRAMES; g++) {
+            if(g >= 0 && g < n && trace.frames[g].truth > 0 && !used[g]) {
+                used[g] = true;
+                (*hits)++;
+                break;
+            }
+        }
+    }
+}
+
+static void bench(const char* name, const BeatTrace& trace) {
+    printf("%s: %d frames, %d bands\n", name, (int)trace.frames.size(), trace.nBands);
+    printf("    %-6s %10s %8s %10s %8s %8s\n", "mode", "ns/frame", "beats", "precision", "recall", "F1");
+    for(int m = BEAT_SOURCE_SDK; m <= BEAT_SOURCE_FUSED; m++) {
+        BeatSourceMode mode = (BeatSourceMode)m;
+        double ns = timeFrames(trace, mode);
+        std::vector<bool> detected = detectedFrames(trace, mode);
+        int hits, nDetected, nTrue;
+        score(trace, detected, &hits, &nDetected, &nTrue);
+        if(!trace.hasTruth()) {
+            printf("    %-6s %10.1f %8d %10s %8s %8s\n", modeNames[m], ns, nDetected, "-", "-", "-");
+            continue;
+        }
+        double precision = nDetected > 0 ? (double)hits / nDetected : 0;
+        double recall = nTrue > 0 ? (double)hits / nTrue : 0;
+        double f1 = precision + recall > 0 ? 2 * precision * recall / (precision + recall) : 0;
+        printf("    %-6s %10.1f %8d %10.3f %8.3f %8.3f\n", modeNames[m], ns, nDetected, precision, recall, f1);
+    }
+}
+
+int main(int argc, char** argv) {
+    if(argc > 1) {
+        for(int i = 1; i < argc; i++) {
+            BeatTrace trace;
+            if(!trace.load(argv[i])) {
+                fprintf(stderr, "%s: no TRACE lines\n", argv[i]);
+                return 1;
+            }
+            bench(argv[i], trace);
+        }
+        return 0;
+    }
+
+    const struct { const char* name; int bands; float bpm; int noise; } synthetic[] = {
+        {"synthetic 7 bands 120bpm", 7, 120, 30},
+        {"synthetic 7 bands 174bpm noisy", 7, 174, 70},
+        {"synthetic 32 bands 90bpm", 32, 90, 30},
+    };
+    for(size_t s = 0; s < sizeof(synthetic) / sizeof(synthetic[0]); s++) {
+        BeatTrace trace;
+        trace.synthesize(6000, synthetic[s].bands, synthetic[s].bpm, synthetic[s].noise, s + 1);
+        bench(synthetic[s].name, trace);
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+/*
+ * BeatTrace.cpp
+ *
+ *  Description:
+ *  Recorded and synthetic beat detector input, see BeatTrace.h.
+ */
+
+#include "BeatTrace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define TRACE_LINE_MAX 4096
+#define TRACE_FRAME_RATE 20.0  // the plugins are called every 50ms
+
+BeatTrace::BeatTrace() {
+    nBands = 0;
+}
+
+bool BeatTrace::load(const char* path) {
+    FILE* file = fopen(path, "r");
+    if(file == NULL) {
+        return false;
+    }
+    frames.clear();
+    notes.clear();
+    nBands = 0;
+    char line[TRACE_LINE_MAX];
+    while(fgets(line, sizeof(line), file) != NULL) {
+        if(strncmp(line, "# ", 2) == 0) {
+            notes.push_back(std::string(line + 2, strcspn(line + 2, "\r\n")));
+            continue;
+        }
+        if(strncmp(line, "TRACE ", 6) != 0) {
+            continue;
+        }
+        trace_frame_t frame;
+        char* p = line + 6;
+        char* end;
+        frame.isBeat = strtol(p, &end, 10) != 0;
+        frame.isOnset = strtol(end, &end, 10) != 0;
+        frame.truth = strtol(end, &end, 10);
+        while(true) {
+            p = end;
+            long value = strtol(p, &end, 10);
+            if(end == p) {
+                break;
+            }
+            frame.bins.push_back(value < 0 ? 0 : value > 255 ? 255 : value);
+        }
+        if(nBands == 0) {
+            nBands = frame.bins.size();
+        }
+        frame.bins.resize(nBands, 0);  // a short line is padded, a long one cut
+        frames.push_back(frame);
+    }
+    fclose(file);
+    return !frames.empty() && nBands > 0;
+}
+
+bool BeatTrace::save(const char* path) const {
+    FILE* file = fopen(path, "w");
+    if(file == NULL) {
+        return false;
+    }
+    for(size_t n = 0; n < notes.size(); n++) {
+        fprintf(file, "# %s\n", notes[n].c_str());
+    }
+    for(size_t f = 0; f < frames.size(); f++) {
+        fprintf(file, "TRACE %d %d %d", frames[f].isBeat, frames[f].isOnset, frames[f].truth);
+        for(int i = 0; i < nBands; i++) {
+            fprintf(file, " %d", frames[f].bins[i]);
+        }
+        fprintf(file, "\n");
+    }
+    fclose(file);
+    return true;
+}
+
+bool BeatTrace::hasTruth() const {
+    for(size_t f = 0; f < frames.size(); f++) {
+        if(frames[f].truth < 0) {
+            return false;
+        }
+    }
+    return !frames.empty();
+}
+
+/** add a decaying hit to a band */
+static void hit(std::vector<float>& level, int band, float amount) {
+    if(band >= 0 && band < (int)level.size() && level[band] < amount) {
+        level[band] = amount;
+    }
+}
+
+void BeatTrace::synthesize(int nFrames, int bands, float bpm, int noise, unsigned seed) {
+    srand48(seed);
+    nBands = bands;
+    frames.assign(nFrames, trace_frame_t());
+    std::vector<float> level(nBands, 0);
+    float framesPerBeat = TRACE_FRAME_RATE * 60 / bpm;
+    float nextBeat = framesPerBeat;
+    int beatCount = 0;
+    int padStart = nFrames * 2 / 5;  // loud sustained section without beats
+    int padEnd = nFrames * 3 / 5;
+    int sdkLate = -1;  // frame an SDK beat was put off to
+
+    for(int f = 0; f < nFrames; f++) {
+        trace_frame_t& frame = frames[f];
+        bool inPad = f >= padStart && f < padEnd;
+        bool beat = false;
+        bool hat = false;
+        for(int i = 0; i < nBands; i++) {
+            level[i] *= 0.55;  // hits ring out over a few frames
+        }
+        if(f >= (int)nextBeat) {
+            nextBeat += framesPerBeat;
+            beatCount++;
+            if(!inPad) {
+                beat = true;
+                // kick in the lows on the downbeats, snare in the mids on the backbeats
+                if(beatCount % 2) {
+                    hit(level, 0, 230);
+                    hit(level, 1, 180);
+                } else {
+                    hit(level, nBands / 2 - 1, 170);
+                    hit(level, nBands / 2, 200);
+                }
+            }
+        } else if(f == (int)(nextBeat - framesPerBeat / 2) && !inPad) {
+            hat = true;
+            hit(level, nBands - 1, 120);
+        }
+        frame.truth = beat;
+        frame.bins.resize(nBands);
+        for(int i = 0; i < nBands; i++) {
+            float value = level[i] + drand48() * noise;
+            if(inPad) {
+                value += 150 + drand48() * 80;  // loud and busy, nothing to dance to
+            }
+            frame.bins[i] = value > 255 ? 255 : value;
+        }
+
+        // a plausible SDK: most beats on time, a few a frame late, some missed, some false alarms
+        frame.isBeat = f == sdkLate;
+        if(beat) {
+            double r = drand48();
+            if(r < 0.75) {
+                frame.isBeat = true;
+            } else if(r < 0.9) {
+                sdkLate = f + 1;
+            }
+        } else if(drand48() < 0.02) {
+            frame.isBeat = true;
+        }
+        frame.isOnset = beat || hat || f == padStart || (inPad && drand48() < 0.05);
+    }
+}
@@ -0,0 +1,65 @@
+/*
+ * BenchPlugin.cpp
+ *
+ *  Description:
+ *  Finding and loading the plugins for the benches, see BenchPlugin.h.
+ */
+
+#include "BenchPlugin.h"
+#include <dlfcn.h>
+#include <sstream>
+#include <time.h>
+
+#ifndef BENCH_PLUGINS
+#error "BENCH_PLUGINS (the makefile's PLUGINS) has to be defined, build with the Bench makefile"
+#endif
+
+std::vector<std::string> benchDefaultPlugins() {
+    std::vector<std::string> names;
+    std::istringstream list(BENCH_PLUGINS);
+    std::string name;
+    while(list >> name) {
+        names.push_back(name);
+    }
+    return names;
+}
+
+std::string benchPluginPath(const std::string& name, const char* dir) {
+    if(name.find(".so") != std::string::npos) {
+        return name;
+    }
+    return std::string(dir) + "/" + name + ".so";
+}
+
+bool loadPlugin(const std::string& path, bench_plugin_t* plugin, std::string* error) {
+    plugin->handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if(!plugin->handle) {
+        *error = dlerror();
+        return false;
+    }
+    plugin->initPlugin = (init_function_t)dlsym(plugin->handle, "initPlugin");
+    plugin->getPluginFrame = (frame_function_t)dlsym(plugin->handle, "getPluginFrame");
+    plugin->pluginCleanup = (cleanup_function_t)dlsym(plugin->handle, "pluginCleanup");
+    if(!plugin->initPlugin || !plugin->getPluginFrame || !plugin->pluginCleanup) {
+        *error = "missing a plugin entry point in " + path;
+        unloadPlugin(plugin);
+        return false;
+    }
+    return true;
+}
+
+void unloadPlugin(bench_plugin_t* plugin) {
+    if(plugin->handle) {
+        dlclose(plugin->handle);
+    }
+    plugin->handle = NULL;
+    plugin->initPlugin = NULL;
+    plugin->getPluginFrame = NULL;
+    plugin->pluginCleanup = NULL;
+}
+
+double benchSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
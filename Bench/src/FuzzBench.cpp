@@ -0,0 +1,555 @@
+/*
+ * FuzzBench.cpp
+ *
+ *  Description:
+ *  Hunts for the sound and layouts that make a plugin's slowest frame as slow as it gets: the stutter an
+ *  average frame time hides, like every band beating at once so spawning, evicting and rendering all peak
+ *  in the same frame. It is a coverage guided fuzzer with the cost of the worst frame as its objective:
+ *
+ *  - an input is a beat trace (see BeatTrace.h) plus a made up layout (panel count and seed)
+ *  - every run is a fork of the fuzzer, so it starts from the plugin's statics as loaded, can't take the
+ *    fuzzer down when it crashes or hangs, and is repeatable (drand48 is seeded from the input)
+ *  - the plugins are built with -fsanitize-coverage=trace-pc (plugins/cov/), every basic block they run
+ *    lands in an edge map shared with the fuzzer, and the number of blocks a frame runs is its cost. Blocks
+ *    are counted instead of timed so the objective doesn't move with the load on the machine.
+ *  - inputs that reach new edges or a new worst frame join the corpus and are mutated further: all bands
+ *    to full, silences, bursts, single values, beat and onset flags, runs copied, repeated, spliced in from
+ *    other inputs or cut out, and the layout grown, shrunk or reshuffled
+ *
+ *      fuzzBench [-t seconds] [-p maxPanels] [-s seed] [-o dir] [plugin ...]
+ *      fuzzBench -r trace ...
+ *
+ *  When the time is up the worst input is minimized (the frames after the worst one dropped, then runs of
+ *  frames before it, as long as the worst frame stays within FUZZ_MINIMIZE_KEEP of its cost), timed on
+ *  the plain build, and saved as dir/<plugin>.trace with the plugin and layout in its notes. Inputs that
+ *  crash or hang are saved as dir/<plugin>.crash.trace. -r replays saved traces on the plain builds and
+ *  prints their worst and median frame times, so they double as regression benchmarks.
+ *
+ *  DancingTiles builds its tables on a thread of its own, so whether a frame still uses the fallback
+ *  render path depends on scheduling and its costs are a little noisier than the others'.
+ */
+
+#include "HostSdk.h"
+#include "BeatTrace.h"
+#include "BenchPlugin.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include <algorithm>
+
+#define FUZZ_SECONDS 60             // fuzzing time per plugin
+#define FUZZ_TRACE_FRAMES 300       // length of the traces the corpus starts from, past GameOfLife's 200 skipped frames
+#define FUZZ_MAX_FRAMES 600
+#define FUZZ_MAX_PANELS 200
+#define FUZZ_SEED_TRACES 4
+#define FUZZ_STACKED_MUTATIONS 4    // up to this many mutations per input
+#define FUZZ_EXEC_TIMEOUT 10        // seconds before a run counts as hung
+#define FUZZ_MINIMIZE_EXECS 300
+#define FUZZ_MINIMIZE_KEEP 0.95     // share of the worst frame's cost a minimized input has to keep
+#define FUZZ_TIMED_RUNS 3           // runs of the plain build for the frame times, the fastest is reported
+#define FUZZ_COVERAGE_SIZE 65536    // edges in the coverage map, a power of two
+
+typedef struct {
+    BeatTrace trace;
+    int nPanels;
+    unsigned layoutSeed;        // seeds the layout and the plugin's random numbers
+    uint64_t worstBlocks;       // once run
+} fuzz_input_t;
+
+typedef enum {
+    FUZZ_OK = 0,
+    FUZZ_CRASH,
+    FUZZ_HANG
+} fuzz_status_t;
+
+typedef struct {
+    fuzz_status_t status;
+    uint64_t worstBlocks;
+    int worstFrame;
+    bool newCoverage;
+} fuzz_result_t;
+
+// what a run leaves behind for the fuzzer, in memory shared with the forked runs
+typedef struct {
+    int framesDone;
+    uint64_t frameBlocks[FUZZ_MAX_FRAMES];
+    double frameSeconds[FUZZ_MAX_FRAMES];
+    bool frameRendered[FUZZ_MAX_FRAMES];
+    uint8_t coverage[FUZZ_COVERAGE_SIZE];   // hits of every edge, wrapping at 256
+} fuzz_shared_t;
+
+static fuzz_shared_t* shared = NULL;
+static thread_local bool tracing = false;  // only the run's own thread is counted
+static uint64_t blocks = 0;
+static uint32_t previousBlock = 0;
+
+/* ---------------------------------------------------------------- coverage */
+
+/** called by -fsanitize-coverage=trace-pc at every basic block of the instrumented plugins */
+extern "C" void __sanitizer_cov_trace_pc() {
+    if(!tracing) {
+        return;
+    }
+    uintptr_t pc = (uintptr_t)__builtin_return_address(0);
+    uint32_t block = ((uint32_t)(pc ^ (pc >> 17)) * 0x9E3779B1u) >> 16;
+    shared->coverage[(block ^ previousBlock) & (FUZZ_COVERAGE_SIZE - 1)]++;
+    previousBlock = block >> 1;
+    blocks++;
+}
+
+/** the hit counts of an edge in AFL's buckets, one bit each: 1, 2, 3, 4-7, 8-15, 16-31, 32-127, 128+ */
+static uint8_t hitBucket(uint8_t hits) {
+    if(hits == 0) return 0;
+    if(hits <= 3) return 1 << (hits - 1);
+    if(hits <= 7) return 8;
+    if(hits <= 15) return 16;
+    if(hits <= 31) return 32;
+    if(hits <= 127) return 64;
+    return 128;
+}
+
+/** true if the last run hit an edge, or an edge as many times, that no run before it did */
+static bool mergeCoverage(std::vector<uint8_t>* seen) {
+    bool fresh = false;
+    for(int e = 0; e < FUZZ_COVERAGE_SIZE; e++) {
+        uint8_t bucket = hitBucket(shared->coverage[e]);
+        if(bucket & ~(*seen)[e]) {
+            (*seen)[e] |= bucket;
+            fresh = true;
+        }
+    }
+    return fresh;
+}
+
+static int edgesSeen(const std::vector<uint8_t>& seen) {
+    int edges = 0;
+    for(int e = 0; e < FUZZ_COVERAGE_SIZE; e++) {
+        edges += seen[e] != 0;
+    }
+    return edges;
+}
+
+/* ---------------------------------------------------------------- running */
+
+/**
+ * @description: run an input in a fork, the frames' costs and the coverage end up in shared
+ * @param traced: count blocks, the plugin must be the instrumented build
+ */
+static fuzz_status_t runInput(const bench_plugin_t& plugin, const fuzz_input_t& input, bool traced) {
+    memset(shared, 0, sizeof(fuzz_shared_t));
+    fflush(stdout);
+    pid_t child = fork();
+    if(child < 0) {
+        return FUZZ_CRASH;
+    }
+    if(child == 0) {
+        alarm(FUZZ_EXEC_TIMEOUT);
+        srand48(input.layoutSeed);
+        srand(input.layoutSeed);
+        hostMakeLayout(input.nPanels, input.layoutSeed);
+        std::vector<Frame_t> frames(input.nPanels);
+        tracing = traced;
+        plugin.initPlugin();
+        int nFrames = std::min((int)input.trace.frames.size(), FUZZ_MAX_FRAMES);
+        for(int f = 0; f < nFrames; f++) {
+            const trace_frame_t& sound = input.trace.frames[f];
+            hostSetAudio(&sound.bins[0], sound.bins.size(), sound.isBeat, sound.isOnset);
+            int nFramesOut = 0;
+            uint64_t startBlocks = blocks;
+            double start = benchSeconds();
+            plugin.getPluginFrame(&frames[0], &nFramesOut, NULL);
+            shared->frameSeconds[f] = benchSeconds() - start;
+            shared->frameBlocks[f] = blocks - startBlocks;
+            shared->frameRendered[f] = nFramesOut > 0;
+            shared->framesDone = f + 1;
+        }
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    if(WIFSIGNALED(status)) {
+        return WTERMSIG(status) == SIGALRM ? FUZZ_HANG : FUZZ_CRASH;
+    }
+    return WEXITSTATUS(status) == 0 ? FUZZ_OK : FUZZ_CRASH;
+}
+
+/** run an input on the instrumented build and see what it did */
+static fuzz_result_t evaluate(const bench_plugin_t& plugin, const fuzz_input_t& input, std::vector<uint8_t>* seen) {
+    fuzz_result_t result;
+    result.status = runInput(plugin, input, true);
+    result.worstBlocks = 0;
+    result.worstFrame = -1;
+    for(int f = 0; f < shared->framesDone; f++) {
+        if(shared->frameBlocks[f] > result.worstBlocks) {
+            result.worstBlocks = shared->frameBlocks[f];
+            result.worstFrame = f;
+        }
+    }
+    result.newCoverage = seen ? mergeCoverage(seen) : false;
+    return result;
+}
+
+/** worst and median frame time of the frames that rendered anything, on the plain build */
+static bool timeInput(const bench_plugin_t& plugin, const fuzz_input_t& input, double* worst, double* median,
+        int* worstFrame) {
+    *worst = *median = 0;
+    *worstFrame = -1;
+    bool ran = false;
+    for(int r = 0; r < FUZZ_TIMED_RUNS; r++) {
+        if(runInput(plugin, input, false) != FUZZ_OK) {
+            continue;
+        }
+        std::vector<double> times;
+        double runWorst = 0;
+        int runWorstFrame = -1;
+        for(int f = 0; f < shared->framesDone; f++) {
+            if(shared->frameRendered[f]) {
+                times.push_back(shared->frameSeconds[f]);
+                if(shared->frameSeconds[f] > runWorst) {
+                    runWorst = shared->frameSeconds[f];
+                    runWorstFrame = f;
+                }
+            }
+        }
+        if(times.empty()) {
+            continue;
+        }
+        std::sort(times.begin(), times.end());
+        // the fastest run is the one the machine disturbed least
+        if(!ran || runWorst < *worst) {
+            *worst = runWorst;
+            *median = times[times.size() / 2];
+            *worstFrame = runWorstFrame;
+        }
+        ran = true;
+    }
+    return ran;
+}
+
+/* ---------------------------------------------------------------- mutation */
+
+static uint64_t rngState = 88172645463325252ull;
+
+static uint32_t random32() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return (uint32_t)(rngState >> 11);
+}
+
+static int randomBelow(int n) {
+    return n > 0 ? random32() % n : 0;
+}
+
+static trace_frame_t silentFrame(int nBands) {
+    trace_frame_t frame;
+    frame.isBeat = frame.isOnset = false;
+    frame.truth = -1;
+    frame.bins.assign(nBands, 0);
+    return frame;
+}
+
+static void mutate(fuzz_input_t* input, const std::vector<fuzz_input_t>& corpus, int maxPanels) {
+    std::vector<trace_frame_t>& frames = input->trace.frames;
+    int nBands = input->trace.nBands;
+    int n = frames.size();
+    int f = randomBelow(n);
+    int length = 1 + randomBelow(std::min(n - f, 32));
+    switch(randomBelow(9)) {
+    case 0: // every band at full with the beat and onset flags up
+        for(int b = 0; b < nBands; b++) {
+            frames[f].bins[b] = 255;
+        }
+        frames[f].isBeat = frames[f].isOnset = true;
+        break;
+    case 1: // a stretch of silence
+        for(int i = f; i < f + length; i++) {
+            frames[i] = silentFrame(nBands);
+        }
+        break;
+    case 2: // one band flipping between silent and full
+        {
+            int band = randomBelow(nBands);
+            for(int i = f; i < f + length; i++) {
+                frames[i].bins[band] = (i - f) % 2 ? 0 : 255;
+            }
+        }
+        break;
+    case 3: // a single value
+        frames[f].bins[randomBelow(nBands)] = random32() & 0xff;
+        break;
+    case 4: // the SDK's flags
+        if(random32() & 1) {
+            frames[f].isBeat = !frames[f].isBeat;
+        } else {
+            frames[f].isOnset = !frames[f].isOnset;
+        }
+        break;
+    case 5: // a run from another input
+        {
+            const std::vector<trace_frame_t>& other = corpus[randomBelow(corpus.size())].trace.frames;
+            int from = randomBelow(other.size());
+            for(int i = 0; i < length && from + i < (int)other.size() && f + i < n; i++) {
+                frames[f + i] = other[from + i];
+            }
+        }
+        break;
+    case 6: // a run played again straight after itself
+        if(n + length <= FUZZ_MAX_FRAMES) {
+            std::vector<trace_frame_t> run(frames.begin() + f, frames.begin() + f + length);
+            frames.insert(frames.begin() + f + length, run.begin(), run.end());
+        }
+        break;
+    case 7: // a run cut out
+        if(n - length >= 1) {
+            frames.erase(frames.begin() + f, frames.begin() + f + length);
+        }
+        break;
+    default: // the layout
+        switch(randomBelow(3)) {
+        case 0:
+            input->nPanels = std::min(input->nPanels * 2, maxPanels);
+            break;
+        case 1:
+            input->nPanels = std::max(input->nPanels / 2, 1);
+            break;
+        default:
+            input->nPanels = 1 + randomBelow(maxPanels);
+            break;
+        }
+        input->layoutSeed = random32();
+        break;
+    }
+}
+
+/* ---------------------------------------------------------------- minimizing and saving */
+
+/** drop everything the worst frame doesn't need */
+static fuzz_input_t minimize(const bench_plugin_t& plugin, fuzz_input_t best) {
+    uint64_t target = best.worstBlocks * FUZZ_MINIMIZE_KEEP;
+    int execs = 0;
+    fuzz_result_t result = evaluate(plugin, best, NULL);
+    if(result.status != FUZZ_OK || result.worstFrame < 0) {
+        return best;
+    }
+    // the frames after the worst one can't matter
+    best.trace.frames.resize(result.worstFrame + 1);
+    for(int chunk = best.trace.frames.size() / 2; chunk >= 1 && execs < FUZZ_MINIMIZE_EXECS; chunk /= 2) {
+        for(int start = 0; start + chunk < (int)best.trace.frames.size() && execs < FUZZ_MINIMIZE_EXECS; ) {
+            fuzz_input_t candidate = best;
+            candidate.trace.frames.erase(candidate.trace.frames.begin() + start,
+                    candidate.trace.frames.begin() + start + chunk);
+            fuzz_result_t r = evaluate(plugin, candidate, NULL);
+            execs++;
+            if(r.status == FUZZ_OK && r.worstBlocks >= target) {
+                candidate.trace.frames.resize(r.worstFrame + 1);
+                candidate.worstBlocks = r.worstBlocks;
+                best = candidate;
+            } else {
+                start += chunk;
+            }
+        }
+    }
+    return best;
+}
+
+static bool saveInput(const fuzz_input_t& input, const std::string& name, const std::string& path,
+        const char* what) {
+    BeatTrace trace = input.trace;
+    char note[256];
+    trace.notes.clear();
+    snprintf(note, sizeof(note), "fuzzBench %s for %s", what, name.c_str());
+    trace.notes.push_back(note);
+    snprintf(note, sizeof(note), "plugin %s", name.c_str());
+    trace.notes.push_back(note);
+    snprintf(note, sizeof(note), "layout %d %u", input.nPanels, input.layoutSeed);
+    trace.notes.push_back(note);
+    snprintf(note, sizeof(note), "worst %llu blocks", (unsigned long long)input.worstBlocks);
+    trace.notes.push_back(note);
+    return trace.save(path.c_str());
+}
+
+/* ---------------------------------------------------------------- fuzzing */
+
+static void fuzzPlugin(const std::string& name, double budget, int maxPanels, const std::string& outDir) {
+    bench_plugin_t traced, plain;
+    std::string error;
+    if(!loadPlugin(benchPluginPath(name, "plugins/cov"), &traced, &error) ||
+            !loadPlugin(benchPluginPath(name), &plain, &error)) {
+        fprintf(stdout, "%-24s can't load it: %s\n", name.c_str(), error.c_str());
+        return;
+    }
+    std::vector<uint8_t> seen(FUZZ_COVERAGE_SIZE, 0);
+    std::vector<fuzz_input_t> corpus;
+    int best = -1;
+    uint64_t seedWorst = 0;
+    for(int s = 0; s < FUZZ_SEED_TRACES; s++) {
+        fuzz_input_t input;
+        input.trace.synthesize(FUZZ_TRACE_FRAMES, HOST_PALETTE_SIZE, 90 + 30 * s, 40, s + 1);
+        input.nPanels = std::max(maxPanels / 2, 1);
+        input.layoutSeed = s + 1;
+        fuzz_result_t result = evaluate(traced, input, &seen);
+        if(result.status != FUZZ_OK) {
+            continue;
+        }
+        input.worstBlocks = result.worstBlocks;
+        corpus.push_back(input);
+        seedWorst = std::max(seedWorst, result.worstBlocks);
+        if(best < 0 || input.worstBlocks > corpus[best].worstBlocks) {
+            best = corpus.size() - 1;
+        }
+    }
+    if(corpus.empty()) {
+        fprintf(stdout, "%-24s fails on the seed traces\n", name.c_str());
+        return;
+    }
+
+    long execs = 0;
+    int crashes = 0;
+    double end = benchSeconds() + budget;
+    while(benchSeconds() < end) {
+        // half the time work on the worst input so far, the rest of the time anything in the corpus
+        const fuzz_input_t& parent = (random32() & 1) ? corpus[best] : corpus[randomBelow(corpus.size())];
+        fuzz_input_t input = parent;
+        int nMutations = 1 + randomBelow(FUZZ_STACKED_MUTATIONS);
+        for(int m = 0; m < nMutations; m++) {
+            mutate(&input, corpus, maxPanels);
+        }
+        fuzz_result_t result = evaluate(traced, input, &seen);
+        execs++;
+        if(result.status != FUZZ_OK) {
+            if(crashes++ == 0) {
+                input.worstBlocks = 0;
+                saveInput(input, name, outDir + "/" + name + ".crash.trace",
+                        result.status == FUZZ_HANG ? "hang" : "crash");
+            }
+            continue;
+        }
+        input.worstBlocks = result.worstBlocks;
+        bool worse = result.worstBlocks > corpus[best].worstBlocks;
+        if(result.newCoverage || worse) {
+            corpus.push_back(input);
+            if(worse) {
+                best = corpus.size() - 1;
+            }
+        }
+    }
+
+    fuzz_input_t worst = minimize(traced, corpus[best]);
+    std::string path = outDir + "/" + name + ".trace";
+    saveInput(worst, name, path, "worst case");
+    double worstTime, medianTime;
+    int worstFrame;
+    if(!timeInput(plain, worst, &worstTime, &medianTime, &worstFrame)) {
+        worstTime = medianTime = 0;
+    }
+    fprintf(stdout, "%-24s %7ld %6d %6d %5d %10llu %10llu %6.1fx %5d %9.1f %9.1f %s%s\n", name.c_str(), execs,
+            (int)corpus.size(), edgesSeen(seen), crashes, (unsigned long long)seedWorst,
+            (unsigned long long)worst.worstBlocks, seedWorst > 0 ? (double)worst.worstBlocks / seedWorst : 0.0,
+            worst.nPanels, worstTime * 1e6, medianTime * 1e6, path.c_str(), crashes ? " (crashes saved)" : "");
+}
+
+/** -r: time saved traces on the plain builds */
+static int replay(const std::vector<std::string>& paths) {
+    fprintf(stdout, "%-32s %-24s %6s %6s %6s %9s %9s\n", "trace", "plugin", "frames", "panels", "worst",
+            "worst us", "median us");
+    int failed = 0;
+    for(size_t i = 0; i < paths.size(); i++) {
+        fuzz_input_t input;
+        char plugin[128] = "";
+        input.nPanels = 0;
+        input.layoutSeed = 0;
+        if(input.trace.load(paths[i].c_str())) {
+            for(size_t n = 0; n < input.trace.notes.size(); n++) {
+                const char* note = input.trace.notes[n].c_str();
+                if(sscanf(note, "plugin %127s", plugin) != 1) {
+                    sscanf(note, "layout %d %u", &input.nPanels, &input.layoutSeed);
+                }
+            }
+        }
+        if(!plugin[0] || input.nPanels < 1) {
+            fprintf(stdout, "%-32s can't be replayed, it needs plugin and layout notes\n", paths[i].c_str());
+            failed++;
+            continue;
+        }
+        bench_plugin_t entry;
+        std::string error;
+        if(!loadPlugin(benchPluginPath(plugin), &entry, &error)) {
+            fprintf(stdout, "%-32s can't load %s: %s\n", paths[i].c_str(), plugin, error.c_str());
+            failed++;
+            continue;
+        }
+        double worst, median;
+        int worstFrame;
+        if(!timeInput(entry, input, &worst, &median, &worstFrame)) {
+            fprintf(stdout, "%-32s %-24s crashes, hangs or renders nothing\n", paths[i].c_str(), plugin);
+            failed++;
+            continue;
+        }
+        fprintf(stdout, "%-32s %-24s %6d %6d %6d %9.1f %9.1f\n", paths[i].c_str(), plugin,
+                (int)input.trace.frames.size(), input.nPanels, worstFrame, worst * 1e6, median * 1e6);
+    }
+    return failed;
+}
+
+static void usage() {
+    fprintf(stderr, "usage: fuzzBench [-t seconds] [-p maxPanels] [-s seed] [-o dir] [plugin ...]\n"
+            "       fuzzBench -r trace ...\n");
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    double budget = FUZZ_SECONDS;
+    int maxPanels = FUZZ_MAX_PANELS;
+    std::string outDir = "traces";
+    bool replaying = false;
+    std::vector<std::string> names;
+    for(int i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "-t") && i + 1 < argc) {
+            budget = atof(argv[++i]);
+        } else if(!strcmp(argv[i], "-p") && i + 1 < argc) {
+            maxPanels = std::max(atoi(argv[++i]), 1);
+        } else if(!strcmp(argv[i], "-s") && i + 1 < argc) {
+            rngState = strtoull(argv[++i], NULL, 10) | 1;
+        } else if(!strcmp(argv[i], "-o") && i + 1 < argc) {
+            outDir = argv[++i];
+        } else if(!strcmp(argv[i], "-r")) {
+            replaying = true;
+        } else if(argv[i][0] == '-') {
+            usage();
+        } else {
+            names.push_back(argv[i]);
+        }
+    }
+    shared = (fuzz_shared_t*)mmap(NULL, sizeof(fuzz_shared_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+            -1, 0);
+    if(shared == MAP_FAILED) {
+        fprintf(stderr, "can't map the shared run state\n");
+        return 1;
+    }
+    if(replaying) {
+        if(names.empty()) {
+            usage();
+        }
+        return replay(names);
+    }
+    if(names.empty()) {
+        names = benchDefaultPlugins();
+    }
+    mkdir(outDir.c_str(), 0755);
+    fprintf(stdout, "%.0f s per plugin, layouts of up to %d panels, worst frame cost in basic blocks\n", budget,
+            maxPanels);
+    fprintf(stdout, "%-24s %7s %6s %6s %5s %10s %10s %7s %5s %9s %9s %s\n", "plugin", "execs", "corpus", "edges",
+            "crash", "seed worst", "found", "", "panels", "worst us", "median us", "saved");
+    for(size_t i = 0; i < names.size(); i++) {
+        fuzzPlugin(names[i], budget, maxPanels, outDir);
+    }
+    return 0;
+}
@@ -0,0 +1,469 @@
+/*
+ * HostSdk.cpp
+ *
+ *  Description:
+ *  Host stand in for the Aurora SDK with cost accounting, see HostSdk.h.
+ */
+
+#undef _FORTIFY_SOURCE     // printf is replaced below, it must not be an inline wrapper here
+
+#include "HostSdk.h"
+#include "ColorUtils.h"
+#include "DataManager.h"
+#include "LayoutProcessingUtils.h"
+#include "PluginFeatures.h"
+#include "Shape.h"
+#include "Point.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <set>
+#include <string>
+#include <vector>
+
+const char* hostPhaseNames[HOST_PHASES] = {"plugin", "layout", "palette", "logging", "features",
+                                            "detect", "spawn", "render", "write"};
+
+/* ---------------------------------------------------------------- accounting */
+
+static host_phase_stats_t phaseStats[HOST_PHASES];
+static int phase = HOST_PHASE_PLUGIN;
+static double phaseStart = 0;
+static thread_local bool accounted = false;        // this thread is the one being measured
+static std::atomic<long> liveBytes(0);
+static host_phase_hook_t phaseHook = NULL;
+
+static double seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** charge the time so far to the current phase and move on to another */
+static int switchPhase(int next) {
+    if(phaseHook) {
+        phaseHook(phase);
+    }
+    double now = seconds();
+    phaseStats[phase].seconds += now - phaseStart;
+    phaseStart = now;
+    int previous = phase;
+    phase = next;
+    return previous;
+}
+
+/** charges the enclosing SDK call to a phase, if it's made from the measured thread */
+class PhaseScope {
+public:
+    explicit PhaseScope(host_phase_t next) {
+        previous = accounted ? switchPhase(next) : -1;
+    }
+    ~PhaseScope() {
+        if(previous >= 0) {
+            switchPhase(previous);
+        }
+    }
+private:
+    int previous;
+};
+
+void hostResetStats() {
+    memset(phaseStats, 0, sizeof(phaseStats));
+    accounted = true;
+    phase = HOST_PHASE_PLUGIN;
+    phaseStart = seconds();
+}
+
+void hostStats(host_phase_stats_t* stats) {
+    switchPhase(phase);
+    memcpy(stats, phaseStats, sizeof(phaseStats));
+}
+
+void hostSetPhaseHook(host_phase_hook_t hook) {
+    phaseHook = hook;
+}
+
+void hostMarkPhase(int mark) {
+    if(!accounted) {
+        return;
+    }
+    int marked = HOST_PHASE_DETECT + mark - 1;
+    switchPhase(mark > 0 && marked < HOST_PHASES ? marked : HOST_PHASE_PLUGIN);
+}
+
+long hostLiveBytes() {
+    return liveBytes.load();
+}
+
+// every allocation carries its size in front of it so deletes can be taken off liveBytes
+#define HOST_ALLOCATION_HEADER 16
+
+static void* allocate(size_t size) {
+    uint8_t* block = (uint8_t*)malloc(size + HOST_ALLOCATION_HEADER);
+    if(!block) {
+        throw std::bad_alloc();
+    }
+    *(size_t*)block = size;
+    liveBytes += size;
+    if(accounted) {
+        phaseStats[phase].allocations++;
+        phaseStats[phase].bytes += size;
+    }
+    return block + HOST_ALLOCATION_HEADER;
+}
+
+static void deallocate(void* p) {
+    if(p) {
+        uint8_t* block = (uint8_t*)p - HOST_ALLOCATION_HEADER;
+        liveBytes -= *(size_t*)block;
+        free(block);
+    }
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+
+/* ---------------------------------------------------------------- logging */
+
+static FILE* logSink = NULL;
+
+void hostSetLogSink(FILE* sink) {
+    logSink = sink;
+}
+
+static FILE* sink() {
+    if(!logSink) {
+        logSink = fopen("/dev/null", "w");
+    }
+    return logSink;
+}
+
+extern "C" {
+
+int vprintf(const char* format, va_list args) {
+    PhaseScope scope(HOST_PHASE_LOGGING);
+    return vfprintf(sink(), format, args);
+}
+
+int printf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vprintf(format, args);
+    va_end(args);
+    return n;
+}
+
+// what printf turns into with _FORTIFY_SOURCE
+int __vprintf_chk(int, const char* format, va_list args) {
+    return vprintf(format, args);
+}
+
+int __printf_chk(int, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vprintf(format, args);
+    va_end(args);
+    return n;
+}
+
+// and for a constant line or a single character
+int puts(const char* s) {
+    PhaseScope scope(HOST_PHASE_LOGGING);
+    fputs(s, sink());
+    return fputc('\n', sink());
+}
+
+int putchar(int c) {
+    PhaseScope scope(HOST_PHASE_LOGGING);
+    return fputc(c, sink());
+}
+
+}
+
+/* ---------------------------------------------------------------- geometry */
+
+Point::Point() : x(0), y(0) {}
+Point::Point(double _x, double _y) : x(_x), y(_y) {}
+Point Point::operator+(Point p2) { return Point(x + p2.x, y + p2.y); }
+Point Point::operator-(Point p2) { return Point(x - p2.x, y - p2.y); }
+
+void Point::ToInt(int* _x, int* _y) {
+    *_x = (int)x;
+    *_y = (int)y;
+}
+
+Point Point::rotate(degrees angle) {
+    double a = degs2rads(angle);
+    return Point(x * cos(a) - y * sin(a), x * sin(a) + y * cos(a));
+}
+
+std::string Point::ToString() {
+    char text[64];
+    snprintf(text, sizeof(text), "(%f, %f)", x, y);
+    return text;
+}
+
+double Point::distance(Point p1, Point p2) {
+    return sqrt((p1.x - p2.x) * (p1.x - p2.x) + (p1.y - p2.y) * (p1.y - p2.y));
+}
+
+double degs2rads(double degs) {
+    return degs * M_PI / 180;
+}
+
+int Shape::sideLength = HOST_SIDE_LENGTH;
+
+Shape::Shape() : orientation(0), vertices(NULL), nVertices(0), area(0), shapeType(SHAPE_TRIANGLE) {}
+Shape::~Shape() { delete[] vertices; }
+const Point& Shape::getCentroid() const { return centroid; }
+int Shape::getOrientation() const { return orientation; }
+
+/** an Aurora triangle, orientation 0 has its apex up (+y) and 60 down */
+class Triangle : public Shape {
+public:
+    Triangle(Point c, int o) {
+        nVertices = 3;
+        vertices = new Point[3];
+        shapeType = SHAPE_TRIANGLE;
+        updateShape(&c, &o);
+    }
+
+    bool isPointInsideShape(Point p) {
+        bool positive = false, negative = false;
+        for(int i = 0; i < 3; i++) {
+            const Point& a = vertices[i];
+            const Point& b = vertices[(i + 1) % 3];
+            double side = (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+            positive = positive || side > 0;
+            negative = negative || side < 0;
+        }
+        return !(positive && negative);
+    }
+
+    void updateShape(Point* c, int* o) {
+        if(c) {
+            centroid = *c;
+        }
+        if(o) {
+            orientation = *o;
+        }
+        double radius = sideLength / sqrt(3.0);
+        for(int i = 0; i < 3; i++) {
+            double a = degs2rads(orientation + 90 + 120 * i);
+            vertices[i] = Point(centroid.x + radius * cos(a), centroid.y + radius * sin(a));
+        }
+        area = sqrt(3.0) / 4 * sideLength * sideLength;
+    }
+};
+
+/* ---------------------------------------------------------------- layout and palette */
+
+typedef struct {
+    double x, y;
+    int orientation;
+} host_panel_t;
+
+static std::vector<host_panel_t> placements;
+static LayoutData* layout = NULL;
+
+void hostMakeLayout(int nPanels, unsigned seed) {
+    hostFreeLayout();
+    placements.clear();
+    // triangles on a lattice: row r, column c, pointing up when r + c is even. Up triangles share their
+    // bottom edge with the row below, down triangles their top edge with the row above.
+    double s = HOST_SIDE_LENGTH;
+    double h = s * sqrt(3.0) / 2;
+    std::set<std::pair<int, int> > seen;
+    std::vector<std::pair<int, int> > frontier;
+    frontier.push_back(std::make_pair(0, 0));
+    seen.insert(frontier[0]);
+    srand(seed);
+    while((int)placements.size() < nPanels) {
+        int k = rand() % frontier.size();
+        std::pair<int, int> cell = frontier[k];
+        frontier[k] = frontier.back();
+        frontier.pop_back();
+        int r = cell.first, c = cell.second;
+        bool up = ((r + c) & 1) == 0;
+        host_panel_t panel = {c * s / 2, r * h + (up ? h / 3 : 2 * h / 3), up ? 0 : 60};
+        placements.push_back(panel);
+        std::pair<int, int> neighbours[3] = {
+            std::make_pair(r, c - 1), std::make_pair(r, c + 1), std::make_pair(up ? r - 1 : r + 1, c)
+        };
+        for(int i = 0; i < 3; i++) {
+            if(seen.insert(neighbours[i]).second) {
+                frontier.push_back(neighbours[i]);
+            }
+        }
+    }
+}
+
+void hostFreeLayout() {
+    delete layout;
+    layout = NULL;
+}
+
+LayoutData* getLayoutData() {
+    PhaseScope scope(HOST_PHASE_LAYOUT);
+    if(!layout) {
+        layout = new LayoutData();
+        layout->nPanels = placements.size();
+        layout->panels = new Panel[placements.size()];
+        double sumX = 0, sumY = 0;
+        for(size_t i = 0; i < placements.size(); i++) {
+            const host_panel_t& p = placements[i];
+            layout->panels[i].panelId = 100 + i;
+            layout->panels[i].shape = new Triangle(Point(p.x, p.y), p.orientation);
+            sumX += p.x;
+            sumY += p.y;
+        }
+        if(!placements.empty()) {
+            layout->layoutGeometricCenter = Point(sumX / placements.size(), sumY / placements.size());
+        }
+    }
+    return layout;
+}
+
+static RGB_t palette[HOST_PALETTE_SIZE] = {
+    {255, 0, 0}, {255, 128, 0}, {255, 255, 0}, {0, 255, 0}, {0, 255, 255}, {0, 0, 255}, {255, 0, 255}
+};
+
+void getColorPalette(RGB_t** colors, int* nColors) {
+    PhaseScope scope(HOST_PHASE_PALETTE);
+    *colors = palette;
+    *nColors = HOST_PALETTE_SIZE;
+}
+
+bool isPointInsidePanel(Panel* panel, Point p) {
+    return panel->shape->isPointInsideShape(p);
+}
+
+int pointInsideWhichPanel(LayoutData* layoutData, Point p) {
+    for(int i = 0; i < layoutData->nPanels; i++) {
+        if(isPointInsidePanel(&layoutData->panels[i], p)) {
+            return layoutData->panels[i].panelId;
+        }
+    }
+    return -1;
+}
+
+/* ---------------------------------------------------------------- features */
+
+static uint8_t fftBins[HOST_FFT_BINS];
+static bool isBeat = false;
+static bool isOnset = false;
+
+void hostSetAudio(const uint8_t* bins, int nBins, bool beat, bool onset) {
+    memset(fftBins, 0, sizeof(fftBins));
+    memcpy(fftBins, bins, std::min(nBins, HOST_FFT_BINS));
+    isBeat = beat;
+    isOnset = onset;
+}
+
+void enableEnergy(void) { PhaseScope scope(HOST_PHASE_FEATURES); }
+void enableFft(uint16_t) { PhaseScope scope(HOST_PHASE_FEATURES); }
+void enableDistance(void) { PhaseScope scope(HOST_PHASE_FEATURES); }
+void enableSpeed(void) { PhaseScope scope(HOST_PHASE_FEATURES); }
+void enableBeatFeatures(void) { PhaseScope scope(HOST_PHASE_FEATURES); }
+
+uint16_t getEnergy(void) {
+    int energy = 0;
+    for(int i = 0; i < HOST_FFT_BINS; i++) {
+        energy += fftBins[i];
+    }
+    return energy;
+}
+
+uint8_t* getFftBins(void) { return fftBins; }
+uint8_t getDistance(void) { return 0; }
+uint8_t getSpeed(void) { return 0; }
+bool getIsBeat(void) { return isBeat; }
+bool getIsOnset(void) { return isOnset; }
+float getTempo(void) { return 120; }
+
+/* ---------------------------------------------------------------- colours */
+
+void HSVtoRGB(HSV_t hsv, RGB_t* rgb) {
+    double h = hsv.H, s = hsv.S / 100.0, v = hsv.V / 100.0;
+    double c = v * s;
+    double x = c * (1 - fabs(fmod(h / 60.0, 2) - 1));
+    double m = v - c;
+    double r = 0, g = 0, b = 0;
+    if(h < 60) {
+        r = c; g = x;
+    } else if(h < 120) {
+        r = x; g = c;
+    } else if(h < 180) {
+        g = c; b = x;
+    } else if(h < 240) {
+        g = x; b = c;
+    } else if(h < 300) {
+        r = x; b = c;
+    } else {
+        r = c; b = x;
+    }
+    rgb->R = (r + m) * 255;
+    rgb->G = (g + m) * 255;
+    rgb->B = (b + m) * 255;
+}
+
+void RGBtoHSV(RGB_t rgb, HSV_t* hsv) {
+    double r = rgb.R / 255.0, g = rgb.G / 255.0, b = rgb.B / 255.0;
+    double high = fmax(r, fmax(g, b));
+    double low = fmin(r, fmin(g, b));
+    double d = high - low;
+    double h = 0;
+    if(d > 0) {
+        if(high == r) {
+            h = 60 * fmod((g - b) / d, 6);
+        } else if(high == g) {
+            h = 60 * ((b - r) / d + 2);
+        } else {
+            h = 60 * ((r - g) / d + 4);
+        }
+    }
+    if(h < 0) {
+        h += 360;
+    }
+    hsv->H = h;
+    hsv->S = high > 0 ? d / high * 100 : 0;
+    hsv->V = high * 100;
+}
+
+RGB_t operator+ (const RGB_t& l, const RGB_t& r) {
+    RGB_t out = {l.R + r.R, l.G + r.G, l.B + r.B};
+    return out;
+}
+
+RGB_t operator- (const RGB_t& l, const RGB_t& r) {
+    RGB_t out = {l.R - r.R, l.G - r.G, l.B - r.B};
+    return out;
+}
+
+RGB_t operator* (const RGB_t& l, int m) {
+    RGB_t out = {l.R * m, l.G * m, l.B * m};
+    return out;
+}
+
+RGB_t operator* (int m, const RGB_t& l) {
+    return l * m;
+}
+
+RGB_t operator/ (const RGB_t& l, float d) {
+    RGB_t out = {(int)(l.R / d), (int)(l.G / d), (int)(l.B / d)};
+    return out;
+}
+
+RGB_t limitRGB(const RGB_t& c, int max, int min) {
+    RGB_t out = {std::max(std::min(c.R, max), min), std::max(std::min(c.G, max), min),
+            std::max(std::min(c.B, max), min)};
+    return out;
+}
@@ -0,0 +1,176 @@
+/*
+ * InitBench.cpp
+ *
+ *  Description:
+ *  How initPlugin scales with the size of the layout. Loads each plugin built for the host (see the
+ *  makefile) and times its initPlugin on made up layouts from a handful of panels to thousands, with the
+ *  time and allocations split by phase (see HostSdk.h):
+ *
+ *      initBench [-r repeats] [-n sizes] [plugin ...]
+ *
+ *  plugin is a name from the plugins/ directory or a path to a .so, all of them when none are given. sizes
+ *  is a comma separated list of panel counts. Every run is a fresh fork of the bench so each initPlugin sees
+ *  its plugin's statics as they are on load, like on the controller; the run with the median time is
+ *  reported. "tables" is the plugin's own code, which for most plugins is working out its tables, and
+ *  "slope" is how the time grows with the number of panels between two sizes (1 is linear, 2 quadratic).
+ *
+ *  A plugin that builds its tables on a thread of its own (DancingTiles with BACKGROUND_INIT) only shows
+ *  what initPlugin waits for.
+ */
+
+#include "HostSdk.h"
+#include "BenchPlugin.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include <algorithm>
+
+#define BENCH_REPEATS 5         // runs per layout size, the median is reported
+#define BENCH_LAYOUT_SEED 7
+
+static const int defaultSizes[] = {9, 30, 100, 300, 1000, 3000, 10000};
+
+typedef struct {
+    host_phase_stats_t phases[HOST_PHASES];
+    long keptBytes;             // still allocated when initPlugin returns
+    double total;
+} init_sample_t;
+
+/** run initPlugin once in a child process, false if it didn't make it back */
+static bool sampleInit(init_function_t initPlugin, init_sample_t* sample) {
+    int fds[2];
+    if(pipe(fds) != 0) {
+        return false;
+    }
+    fflush(stdout);
+    pid_t child = fork();
+    if(child < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if(child == 0) {
+        close(fds[0]);
+        init_sample_t result;
+        long before = hostLiveBytes();
+        hostResetStats();
+        initPlugin();
+        hostStats(result.phases);
+        result.keptBytes = hostLiveBytes() - before;
+        result.total = 0;
+        for(int p = 0; p < HOST_PHASES; p++) {
+            result.total += result.phases[p].seconds;
+        }
+        ssize_t written = write(fds[1], &result, sizeof(result));
+        _exit(written == sizeof(result) ? 0 : 1);
+    }
+    close(fds[1]);
+    size_t got = 0;
+    while(got < sizeof(*sample)) {
+        ssize_t n = read(fds[0], (char*)sample + got, sizeof(*sample) - got);
+        if(n <= 0) {
+            break;
+        }
+        got += n;
+    }
+    close(fds[0]);
+    int status = 0;
+    waitpid(child, &status, 0);
+    return got == sizeof(*sample) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static bool byTotal(const init_sample_t& a, const init_sample_t& b) {
+    return a.total < b.total;
+}
+
+static void benchPlugin(const std::string& name, const std::string& path, const std::vector<int>& sizes,
+        int repeats) {
+    fprintf(stdout, "\n%s\n", name.c_str());
+    bench_plugin_t plugin;
+    std::string error;
+    if(!loadPlugin(path, &plugin, &error)) {
+        fprintf(stdout, "  can't load it: %s\n", error.c_str());
+        return;
+    }
+    fprintf(stdout, "  %7s %9s %8s %8s %8s %8s %8s %9s %9s %9s %6s\n", "panels", "init ms", "layout", "palette",
+            "logging", "tables", "features", "allocs", "alloc KB", "kept KB", "slope");
+    double previousTotal = 0;
+    int previousSize = 0;
+    for(size_t s = 0; s < sizes.size(); s++) {
+        hostMakeLayout(sizes[s], BENCH_LAYOUT_SEED);
+        std::vector<init_sample_t> samples;
+        for(int r = 0; r < repeats; r++) {
+            init_sample_t sample;
+            if(sampleInit(plugin.initPlugin, &sample)) {
+                samples.push_back(sample);
+            }
+        }
+        if(samples.empty()) {
+            fprintf(stdout, "  %7d   initPlugin failed\n", sizes[s]);
+            continue;
+        }
+        std::sort(samples.begin(), samples.end(), byTotal);
+        const init_sample_t& median = samples[samples.size() / 2];
+        long allocations = 0, bytes = 0;
+        for(int p = 0; p < HOST_PHASES; p++) {
+            allocations += median.phases[p].allocations;
+            bytes += median.phases[p].bytes;
+        }
+        fprintf(stdout, "  %7d %9.3f %8.3f %8.3f %8.3f %8.3f %8.3f %9ld %9.1f %9.1f", sizes[s], median.total * 1e3,
+                median.phases[HOST_PHASE_LAYOUT].seconds * 1e3, median.phases[HOST_PHASE_PALETTE].seconds * 1e3,
+                median.phases[HOST_PHASE_LOGGING].seconds * 1e3, median.phases[HOST_PHASE_PLUGIN].seconds * 1e3,
+                median.phases[HOST_PHASE_FEATURES].seconds * 1e3, allocations, bytes / 1024.0,
+                median.keptBytes / 1024.0);
+        if(previousSize > 0 && previousTotal > 0) {
+            fprintf(stdout, " %6.2f", log(median.total / previousTotal) / log((double)sizes[s] / previousSize));
+        }
+        fprintf(stdout, "\n");
+        previousTotal = median.total;
+        previousSize = sizes[s];
+    }
+    hostFreeLayout();
+    unloadPlugin(&plugin);
+}
+
+static void usage() {
+    fprintf(stderr, "usage: initBench [-r repeats] [-n panels,panels,...] [plugin ...]\n");
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    int repeats = BENCH_REPEATS;
+    std::vector<int> sizes(defaultSizes, defaultSizes + sizeof(defaultSizes) / sizeof(defaultSizes[0]));
+    std::vector<std::string> names;
+    for(int i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "-r") && i + 1 < argc) {
+            repeats = std::max(atoi(argv[++i]), 1);
+        } else if(!strcmp(argv[i], "-n") && i + 1 < argc) {
+            sizes.clear();
+            for(char* size = strtok(argv[++i], ","); size; size = strtok(NULL, ",")) {
+                if(atoi(size) > 0) {
+                    sizes.push_back(atoi(size));
+                }
+            }
+        } else if(argv[i][0] == '-') {
+            usage();
+        } else {
+            names.push_back(argv[i]);
+        }
+    }
+    if(names.empty()) {
+        names = benchDefaultPlugins();
+    }
+    if(sizes.empty()) {
+        usage();
+    }
+    fprintf(stdout, "initPlugin cost, times in ms, median of %d runs\n", repeats);
+    for(size_t i = 0; i < names.size(); i++) {
+        benchPlugin(names[i], benchPluginPath(names[i]), sizes, repeats);
+    }
+    return 0;
+}
@@ -0,0 +1,245 @@
+/*
+ * PerfBench.cpp
+ *
+ *  Description:
+ *  What the CPU does while a plugin renders a frame: the hardware counters (see PerfCounters.h) around
+ *  every getPluginFrame, split into the phases HostSdk tells apart (the plugin's own code, logging, and the
+ *  stages a plugin marks with hostMarkPhase: detect, spawn, render, write), so it shows whether a plugin is
+ *  limited by computation (high IPC) or by memory (cache misses) on a big layout, and in which stage.
+ *
+ *      perfBench [-f frames] [-p panels] [-o frames.csv] [plugin ...]
+ *
+ *  plugin is a name from the plugins/ directory or a path to a .so, all of them when none are given. The
+ *  plugin is fed a synthetic beat trace; frames it skips (rendering nothing) are left out of the averages.
+ *  With -o every frame's counters go to a CSV file too, one line per frame and phase. Where counters are
+ *  missing (no PMU in a VM or container, perf_event_paranoid too high) their columns read n/a and the rest
+ *  is still reported; with none at all it's just the wall time.
+ */
+
+#include "HostSdk.h"
+#include "BeatTrace.h"
+#include "PerfCounters.h"
+#include "BenchPlugin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include <algorithm>
+
+#define PERF_FRAMES 500
+#define PERF_PANELS 1000
+#define PERF_SEED 7
+#define PERF_ALL_PHASES HOST_PHASES     // the row for the whole frame
+
+typedef struct {
+    uint64_t counts[PERF_COUNTERS];
+    double seconds;
+} phase_counts_t;
+
+static PerfCounters counters;
+static uint64_t lastCounts[PERF_COUNTERS];
+static double lastTime;
+static phase_counts_t frameCounts[HOST_PHASES + 1];    // this frame, by phase
+
+/** charge the counts since the last call to a phase, HostSdk calls this on every phase change */
+static void chargePhase(int phase) {
+    uint64_t now[PERF_COUNTERS];
+    counters.read(now);
+    double time = benchSeconds();
+    for(int c = 0; c < PERF_COUNTERS; c++) {
+        frameCounts[phase].counts[c] += now[c] - lastCounts[c];
+        lastCounts[c] = now[c];
+    }
+    frameCounts[phase].seconds += time - lastTime;
+    lastTime = time;
+}
+
+static void addCounts(phase_counts_t* total, const phase_counts_t& add) {
+    for(int c = 0; c < PERF_COUNTERS; c++) {
+        total->counts[c] += add.counts[c];
+    }
+    total->seconds += add.seconds;
+}
+
+/** one column, n/a if the counter isn't there */
+static void printColumn(int counter, double value, int width, int decimals) {
+    if(counters.available(counter)) {
+        fprintf(stdout, " %*.*f", width, decimals, value);
+    } else {
+        fprintf(stdout, " %*s", width, "n/a");
+    }
+}
+
+static void printRow(const char* phase, const phase_counts_t& total, int nFrames) {
+    double perFrame = 1.0 / nFrames;
+    const uint64_t* c = total.counts;
+    fprintf(stdout, "  %-9s %10.1f", phase, total.seconds * 1e6 * perFrame);
+    printColumn(PERF_CYCLES, c[PERF_CYCLES] * perFrame, 11, 0);
+    printColumn(PERF_INSTRUCTIONS, c[PERF_INSTRUCTIONS] * perFrame, 11, 0);
+    if(counters.available(PERF_CYCLES) && counters.available(PERF_INSTRUCTIONS) && c[PERF_CYCLES] > 0) {
+        fprintf(stdout, " %5.2f", (double)c[PERF_INSTRUCTIONS] / c[PERF_CYCLES]);
+    } else {
+        fprintf(stdout, " %5s", "n/a");
+    }
+    printColumn(PERF_L1D_MISSES, c[PERF_L1D_MISSES] * perFrame, 9, 0);
+    printColumn(PERF_LLC_MISSES, c[PERF_LLC_MISSES] * perFrame, 9, 0);
+    printColumn(PERF_BRANCH_MISSES, c[PERF_BRANCH_MISSES] * perFrame, 9, 0);
+    printColumn(PERF_TASK_CLOCK, c[PERF_TASK_CLOCK] * perFrame / 1e3, 9, 1);
+    printColumn(PERF_PAGE_FAULTS, c[PERF_PAGE_FAULTS] * perFrame, 7, 2);
+    fprintf(stdout, "\n");
+}
+
+static void writeCsvHeader(FILE* csv) {
+    fprintf(csv, "plugin,frame,phase,us");
+    for(int c = 0; c < PERF_COUNTERS; c++) {
+        fprintf(csv, ",%s", PerfCounters::name(c));
+    }
+    fprintf(csv, "\n");
+}
+
+static void writeCsv(FILE* csv, const std::string& name, int frame, const char* phase, const phase_counts_t& counts) {
+    fprintf(csv, "%s,%d,%s,%.3f", name.c_str(), frame, phase, counts.seconds * 1e6);
+    for(int c = 0; c < PERF_COUNTERS; c++) {
+        if(counters.available(c)) {
+            fprintf(csv, ",%llu", (unsigned long long)counts.counts[c]);
+        } else {
+            fprintf(csv, ",");
+        }
+    }
+    fprintf(csv, "\n");
+}
+
+/** run one plugin in this process and print its table */
+static bool perfPlugin(const std::string& name, const std::string& path, int nFrames, int nPanels, FILE* csv) {
+    bench_plugin_t plugin;
+    std::string error;
+    if(!loadPlugin(path, &plugin, &error)) {
+        fprintf(stdout, "\n%s: can't load it: %s\n", name.c_str(), error.c_str());
+        return false;
+    }
+
+    BeatTrace trace;
+    trace.synthesize(nFrames, HOST_PALETTE_SIZE, 120, 40, PERF_SEED);
+    hostMakeLayout(nPanels, PERF_SEED);
+    plugin.initPlugin();
+
+    std::vector<Frame_t> frames(nPanels);
+    phase_counts_t totals[HOST_PHASES + 1];
+    memset(totals, 0, sizeof(totals));
+    int rendered = 0;
+    hostResetStats();
+    hostSetPhaseHook(chargePhase);
+    for(int f = 0; f < nFrames; f++) {
+        const trace_frame_t& sound = trace.frames[f];
+        hostSetAudio(&sound.bins[0], sound.bins.size(), sound.isBeat, sound.isOnset);
+        memset(frameCounts, 0, sizeof(frameCounts));
+        int nFramesOut = 0;
+        counters.read(lastCounts);
+        lastTime = benchSeconds();
+        plugin.getPluginFrame(&frames[0], &nFramesOut, NULL);
+        chargePhase(HOST_PHASE_PLUGIN);
+        for(int p = 0; p < HOST_PHASES; p++) {
+            addCounts(&frameCounts[PERF_ALL_PHASES], frameCounts[p]);
+        }
+        if(nFramesOut == 0) {
+            continue;
+        }
+        rendered++;
+        for(int p = 0; p <= PERF_ALL_PHASES; p++) {
+            addCounts(&totals[p], frameCounts[p]);
+            if(csv && (p == PERF_ALL_PHASES || frameCounts[p].seconds > 0)) {
+                writeCsv(csv, name, f, p == PERF_ALL_PHASES ? "frame" : hostPhaseNames[p], frameCounts[p]);
+            }
+        }
+    }
+    hostSetPhaseHook(NULL);
+    plugin.pluginCleanup();
+    hostFreeLayout();
+
+    fprintf(stdout, "\n%s, %d panels, %d of %d frames rendered\n", name.c_str(), nPanels, rendered, nFrames);
+    if(rendered == 0) {
+        return true;
+    }
+    fprintf(stdout, "  %-9s %10s %11s %11s %5s %9s %9s %9s %9s %7s\n", "phase", "us/frame", "cycles", "instr",
+            "IPC", "L1D miss", "LLC miss", "br miss", "cpu us", "faults");
+    for(int p = 0; p < HOST_PHASES; p++) {
+        if(totals[p].seconds > 0) {
+            printRow(hostPhaseNames[p], totals[p], rendered);
+        }
+    }
+    printRow("frame", totals[PERF_ALL_PHASES], rendered);
+    return true;
+}
+
+static void usage() {
+    fprintf(stderr, "usage: perfBench [-f frames] [-p panels] [-o frames.csv] [plugin ...]\n");
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    int nFrames = PERF_FRAMES;
+    int nPanels = PERF_PANELS;
+    const char* csvPath = NULL;
+    std::vector<std::string> names;
+    for(int i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "-f") && i + 1 < argc) {
+            nFrames = std::max(atoi(argv[++i]), 1);
+        } else if(!strcmp(argv[i], "-p") && i + 1 < argc) {
+            nPanels = std::max(atoi(argv[++i]), 1);
+        } else if(!strcmp(argv[i], "-o") && i + 1 < argc) {
+            csvPath = argv[++i];
+        } else if(argv[i][0] == '-') {
+            usage();
+        } else {
+            names.push_back(argv[i]);
+        }
+    }
+    if(names.empty()) {
+        names = benchDefaultPlugins();
+    }
+    FILE* csv = NULL;
+    if(csvPath) {
+        csv = fopen(csvPath, "w");
+        if(!csv) {
+            fprintf(stderr, "can't write %s\n", csvPath);
+            return 1;
+        }
+        writeCsvHeader(csv);
+        fflush(csv);
+    }
+
+    int opened = counters.open();
+    if(opened < PERF_COUNTERS) {
+        fprintf(stdout, "%d of %d counters available (%s), the rest read n/a\n", opened, PERF_COUNTERS,
+                counters.unavailableReason());
+    }
+    counters.close();   // each plugin's process opens its own
+
+    for(size_t i = 0; i < names.size(); i++) {
+        std::string path = benchPluginPath(names[i]);
+        fflush(stdout);
+        pid_t child = fork();
+        if(child == 0) {
+            counters.open();
+            bool ok = perfPlugin(names[i], path, nFrames, nPanels, csv);
+            fflush(stdout);
+            if(csv) {
+                fflush(csv);
+            }
+            _exit(ok ? 0 : 1);
+        }
+        int status = 0;
+        if(child < 0 || waitpid(child, &status, 0) < 0) {
+            fprintf(stdout, "\n%s: couldn't be run\n", names[i].c_str());
+        } else if(WIFSIGNALED(status)) {
+            fprintf(stdout, "\n%s: killed by signal %d\n", names[i].c_str(), WTERMSIG(status));
+        }
+    }
+    if(csv) {
+        fclose(csv);
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * PerfCounters.cpp
+ *
+ *  Description:
+ *  perf_event_open counters for the calling thread, see PerfCounters.h.
+ */
+
+#include "PerfCounters.h"
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+typedef struct {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+} perf_event_spec_t;
+
+#define PERF_CACHE_EVENT(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static const perf_event_spec_t events[PERF_COUNTERS] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"L1D misses", PERF_TYPE_HW_CACHE, PERF_CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D)},
+    {"LLC misses", PERF_TYPE_HW_CACHE, PERF_CACHE_EVENT(PERF_COUNT_HW_CACHE_LL)},
+    {"branch misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"task clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {"page faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS}
+};
+
+PerfCounters::PerfCounters() : reason(NULL) {
+    for(int c = 0; c < PERF_COUNTERS; c++) {
+        fds[c] = -1;
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    close();
+}
+
+int PerfCounters::open() {
+    close();
+    int opened = 0;
+    for(int c = 0; c < PERF_COUNTERS; c++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[c].type;
+        attr.config = events[c].config;
+        attr.exclude_kernel = 1;    // all an unprivileged user gets with perf_event_paranoid at 2
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // this thread on whatever CPU it runs on
+        fds[c] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if(fds[c] < 0) {
+            if(!reason) {
+                // ENOENT: no PMU (VMs, containers), EACCES/EPERM: perf_event_paranoid, ENOSYS: no perf at all
+                reason = strerror(errno);
+            }
+            continue;
+        }
+        ioctl(fds[c], PERF_EVENT_IOC_RESET, 0);
+        ioctl(fds[c], PERF_EVENT_IOC_ENABLE, 0);
+        opened++;
+    }
+    return opened;
+}
+
+void PerfCounters::close() {
+    for(int c = 0; c < PERF_COUNTERS; c++) {
+        if(fds[c] >= 0) {
+            ::close(fds[c]);
+            fds[c] = -1;
+        }
+    }
+    reason = NULL;
+}
+
+void PerfCounters::read(uint64_t* values) const {
+    for(int c = 0; c < PERF_COUNTERS; c++) {
+        uint64_t data[3];   // value, time enabled, time running
+        values[c] = 0;
+        if(fds[c] < 0 || ::read(fds[c], data, sizeof(data)) != sizeof(data)) {
+            continue;
+        }
+        if(data[2] > 0 && data[2] < data[1]) {
+            // multiplexed with other events, only counted part of the time
+            values[c] = (uint64_t)((double)data[0] * data[1] / data[2]);
+        } else {
+            values[c] = data[0];
+        }
+    }
+}
+
+const char* PerfCounters::name(int counter) {
+    return events[counter].name;
+}
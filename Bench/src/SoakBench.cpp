@@ -0,0 +1,184 @@
+/*
+ * SoakBench.cpp
+ *
+ *  Description:
+ *  Switches to each plugin and away from it over and over, the way the controller does when the user
+ *  changes effects, and checks that nothing piles up: every cycle is initPlugin, a run of frames fed from a
+ *  synthetic beat trace, then pluginCleanup, all in one process so the plugin's statics live on from one
+ *  cycle to the next.
+ *
+ *      soakBench [-c cycles] [-f frames] [-p panels] [plugin ...]
+ *
+ *  plugin is a name from the plugins/ directory or a path to a .so, all of them when none are given. Each
+ *  plugin is soaked in a process of its own. After the first SOAK_WARMUP_SHARE of the cycles (allocator and
+ *  caches settling) the plugin fails if
+ *
+ *  - the heap still allocated after pluginCleanup grows at all, or
+ *  - the resident set grows by more than SOAK_RSS_SLACK_KB, or
+ *  - the median frame time of the last cycles is more than SOAK_LATENCY_RATIO times that of the first ones
+ *
+ *  and the exit status is the number of plugins that failed.
+ */
+
+#include "HostSdk.h"
+#include "BeatTrace.h"
+#include "BenchPlugin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include <algorithm>
+
+#define SOAK_CYCLES 1000
+#define SOAK_FRAMES 250         // frames per cycle, enough to get past the frames the plugins sit out at the start
+#define SOAK_PANELS 30
+#define SOAK_WARMUP_SHARE 0.1   // share of the cycles before the baseline is taken
+#define SOAK_WINDOW_SHARE 0.1   // share of the cycles the first and last frame times are taken over
+#define SOAK_RSS_SLACK_KB 256   // resident set growth allowed, for allocator noise
+#define SOAK_LATENCY_RATIO 1.5
+#define SOAK_TRACE_FRAMES 4000
+#define SOAK_SEED 7
+
+typedef struct {
+    long heapBytes;         // still allocated after pluginCleanup
+    long rssKb;             // resident set after pluginCleanup
+    double frameSeconds;    // mean time of the frames that rendered anything, the warm up frames don't
+} soak_cycle_t;
+
+static long residentKb() {
+    long pages = 0, resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if(statm) {
+        if(fscanf(statm, "%ld %ld", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(statm);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/** median frame time over cycles [begin, end) */
+static double medianFrameSeconds(const std::vector<soak_cycle_t>& cycles, int begin, int end) {
+    std::vector<double> times;
+    for(int c = begin; c < end; c++) {
+        times.push_back(cycles[c].frameSeconds);
+    }
+    std::sort(times.begin(), times.end());
+    return times.empty() ? 0 : times[times.size() / 2];
+}
+
+/** soak one plugin in this process, true if it passes */
+static bool soakPlugin(const std::string& name, const std::string& path, int nCycles, int nFrames, int nPanels) {
+    bench_plugin_t plugin;
+    std::string error;
+    if(!loadPlugin(path, &plugin, &error)) {
+        fprintf(stdout, "%-24s can't load it: %s\n", name.c_str(), error.c_str());
+        return false;
+    }
+
+    BeatTrace trace;
+    trace.synthesize(SOAK_TRACE_FRAMES, HOST_PALETTE_SIZE, 120, 40, SOAK_SEED);
+    hostMakeLayout(nPanels, SOAK_SEED);
+    std::vector<Frame_t> frames(nPanels);
+    std::vector<soak_cycle_t> cycles(nCycles);
+    long traceFrame = 0;
+    for(int c = 0; c < nCycles; c++) {
+        plugin.initPlugin();
+        double elapsed = 0;
+        int rendered = 0;
+        for(int f = 0; f < nFrames; f++) {
+            const trace_frame_t& sound = trace.frames[traceFrame++ % trace.frames.size()];
+            hostSetAudio(&sound.bins[0], sound.bins.size(), sound.isBeat, sound.isOnset);
+            int nFramesOut = 0;
+            double start = benchSeconds();
+            plugin.getPluginFrame(&frames[0], &nFramesOut, NULL);
+            if(nFramesOut > 0) {
+                elapsed += benchSeconds() - start;
+                rendered++;
+            }
+        }
+        plugin.pluginCleanup();
+        // the SDK hands each initPlugin a freshly parsed layout
+        hostFreeLayout();
+        cycles[c].heapBytes = hostLiveBytes();
+        cycles[c].rssKb = residentKb();
+        cycles[c].frameSeconds = rendered > 0 ? elapsed / rendered : 0;
+    }
+
+    int baseline = std::min((int)(nCycles * SOAK_WARMUP_SHARE), nCycles - 1);
+    int window = std::max((int)(nCycles * SOAK_WINDOW_SHARE), 1);
+    const soak_cycle_t& first = cycles[baseline];
+    const soak_cycle_t& last = cycles[nCycles - 1];
+    double firstFrame = medianFrameSeconds(cycles, baseline, std::min(baseline + window, nCycles));
+    double lastFrame = medianFrameSeconds(cycles, std::max(nCycles - window, baseline), nCycles);
+    long leaked = last.heapBytes - first.heapBytes;
+    long rssGrowth = last.rssKb - first.rssKb;
+    bool heapFlat = leaked <= 0;
+    bool rssFlat = rssGrowth <= SOAK_RSS_SLACK_KB;
+    bool latencyStable = lastFrame <= firstFrame * SOAK_LATENCY_RATIO;
+    bool pass = heapFlat && rssFlat && latencyStable;
+    fprintf(stdout, "%-24s %8.1f %8.1f %8.1f %8ld %8ld %9.2f %9.2f   %s%s%s%s\n", name.c_str(),
+            first.heapBytes / 1024.0, last.heapBytes / 1024.0, (nCycles - 1 - baseline) > 0 ?
+            (double)leaked / (nCycles - 1 - baseline) : 0.0, first.rssKb, last.rssKb, firstFrame * 1e6,
+            lastFrame * 1e6, pass ? "ok" : "FAIL", heapFlat ? "" : " heap", rssFlat ? "" : " rss",
+            latencyStable ? "" : " latency");
+    return pass;
+}
+
+static void usage() {
+    fprintf(stderr, "usage: soakBench [-c cycles] [-f frames] [-p panels] [plugin ...]\n");
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    int nCycles = SOAK_CYCLES;
+    int nFrames = SOAK_FRAMES;
+    int nPanels = SOAK_PANELS;
+    std::vector<std::string> names;
+    for(int i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "-c") && i + 1 < argc) {
+            nCycles = std::max(atoi(argv[++i]), 2);
+        } else if(!strcmp(argv[i], "-f") && i + 1 < argc) {
+            nFrames = std::max(atoi(argv[++i]), 1);
+        } else if(!strcmp(argv[i], "-p") && i + 1 < argc) {
+            nPanels = std::max(atoi(argv[++i]), 1);
+        } else if(argv[i][0] == '-') {
+            usage();
+        } else {
+            names.push_back(argv[i]);
+        }
+    }
+    if(names.empty()) {
+        names = benchDefaultPlugins();
+    }
+    fprintf(stdout, "%d cycles of initPlugin, %d frames and pluginCleanup on %d panels\n", nCycles, nFrames, nPanels);
+    fprintf(stdout, "%-24s %8s %8s %8s %8s %8s %9s %9s\n", "plugin", "heap KB", "heap KB", "B/cycle", "RSS KB",
+            "RSS KB", "frame us", "frame us");
+    fprintf(stdout, "%-24s %8s %8s %8s %8s %8s %9s %9s\n", "", "first", "last", "leaked", "first", "last", "first",
+            "last");
+    int failed = 0;
+    for(size_t i = 0; i < names.size(); i++) {
+        std::string path = benchPluginPath(names[i]);
+        fflush(stdout);
+        pid_t child = fork();
+        if(child == 0) {
+            bool pass = soakPlugin(names[i], path, nCycles, nFrames, nPanels);
+            fflush(stdout);
+            _exit(pass ? 0 : 1);
+        }
+        int status = 0;
+        if(child < 0 || waitpid(child, &status, 0) < 0) {
+            fprintf(stdout, "%-24s couldn't be run\n", names[i].c_str());
+            failed++;
+        } else if(WIFSIGNALED(status)) {
+            fprintf(stdout, "%-24s FAIL killed by signal %d\n", names[i].c_str(), WTERMSIG(status));
+            failed++;
+        } else if(WEXITSTATUS(status) != 0) {
+            failed++;
+        }
+    }
+    return failed;
+}
@@ -4,20 +4,56 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 CPP_SRCS += \
-../src/AuroraPlugin.cpp 
+../src/AuroraPlugin.cpp \
+../src/BandHistory.cpp \
+../src/BeatQueue.cpp \
+../src/BeatSource.cpp \
+../src/FalloffCurves.cpp \
+../src/FrameWriter.cpp \
+../src/InitScheduler.cpp \
+../src/PaletteLut.cpp \
+../src/PanelBloom.cpp \
+../src/PanelGeometry.cpp \
+../src/PanelGraph.cpp \
+../src/PanelOrder.cpp \
+../src/SourceQuadTree.cpp 
 
 OBJS += \
-./src/AuroraPlugin.o 
+./src/AuroraPlugin.o \
+./src/BandHistory.o \
+./src/BeatQueue.o \
+./src/BeatSource.o \
+./src/FalloffCurves.o \
+./src/FrameWriter.o \
+./src/InitScheduler.o \
+./src/PaletteLut.o \
+./src/PanelBloom.o \
+./src/PanelGeometry.o \
+./src/PanelGraph.o \
+./src/PanelOrder.o \
+./src/SourceQuadTree.o 
 
 CPP_DEPS += \
-./src/AuroraPlugin.d 
+./src/AuroraPlugin.d \
+./src/BandHistory.d \
+./src/BeatQueue.d \
+./src/BeatSource.d \
+./src/FalloffCurves.d \
+./src/FrameWriter.d \
+./src/InitScheduler.d \
+./src/PaletteLut.d \
+./src/PanelBloom.d \
+./src/PanelGeometry.d \
+./src/PanelGraph.d \
+./src/PanelOrder.d \
+./src/SourceQuadTree.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
 src/%.o: ../src/%.cpp
 	@echo 'Building file: $<'
 	@echo 'Invoking: Cross G++ Compiler'
-	g++ -I../inc -O0 -g3 -Wall -c -fmessage-length=0 -std=c++11 -fPIC -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	g++ -I../inc -O0 -g3 -Wall -c -fmessage-length=0 -std=c++11 -fPIC -pthread -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
 	@echo 'Finished building: $<'
 	@echo ' '
 
@@ -0,0 +1,71 @@
+/*
+ * BandHistory.h
+ *
+ *  Description:
+ *  The last few seconds of every FFT band, with statistics over that window kept up to date as frames come
+ *  in, so a detector, gain control or visualization can ask for them without going over the history again.
+ *
+ *  Each band keeps its last 2^windowLog2 values in a ring. The sum and the sum of squares of the window are
+ *  exact integers, updated by adding the new value and taking off the one that drops out, so the mean and
+ *  variance are O(1). The exponential average is updated per frame. The window maximum and minimum come from
+ *  monotonic deques: a ring of frame numbers whose values only go down (for the maximum) from front to
+ *  back, so the front is the maximum and every frame is added and dropped once, O(1) amortized.
+ */
+
+#ifndef INC_BANDHISTORY_H_
+#define INC_BANDHISTORY_H_
+
+#include <stdint.h>
+#include <vector>
+
+class BandHistory {
+public:
+    BandHistory();
+
+    /**
+     * @param nBands: number of FFT bands
+     * @param windowLog2: the window is 2^windowLog2 frames
+     * @param emaAlpha: weight of the newest frame in the exponential average
+     */
+    void init(int nBands, int windowLog2, float emaAlpha);
+
+    /** @description: add one frame, nBands values */
+    void push(const uint8_t* bins);
+
+    /** @description: value of a band age frames ago, 0 is the newest. 0 before there was such a frame */
+    uint8_t at(int band, int age) const {
+        return age < count ? values[band * window + ((frame - 1 - age) & mask)] : 0;
+    }
+
+    /** @description: number of frames in the window, less than the window size at the start */
+    int size() const { return count; }
+
+    uint32_t sum(int band) const { return sums[band]; }
+    float mean(int band) const { return count > 0 ? (float)sums[band] / count : 0; }
+    float variance(int band) const;
+    float ema(int band) const { return emas[band]; }
+    uint8_t max(int band) const;
+    uint8_t min(int band) const;
+
+private:
+    /** a deque of frame numbers in a ring, big enough for a whole window */
+    struct deque_t {
+        uint32_t front;  // index of the first entry, both only ever go up
+        uint32_t back;   // index after the last entry
+    };
+
+    int nBands;
+    int window;
+    uint32_t mask;
+    int count;
+    uint32_t frame;                 // number of frames pushed
+    float emaAlpha;
+    std::vector<uint8_t> values;    // nBands rings of window values
+    std::vector<uint32_t> sums;
+    std::vector<uint64_t> sumSquares;
+    std::vector<float> emas;
+    std::vector<deque_t> maxDeques, minDeques;
+    std::vector<uint32_t> maxFrames, minFrames;  // nBands rings of window frame numbers
+};
+
+#endif /* INC_BANDHISTORY_H_ */
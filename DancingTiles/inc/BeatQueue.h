@@ -0,0 +1,79 @@
+/*
+ * BeatQueue.h
+ *
+ *  Description:
+ *  A fixed size ring of beat events. The beat detector pushes an event for every band that beats (and one
+ *  for a frame where only the SDK reported a beat or onset); everything that reacts to beats reads them
+ *  through its own cursor, so spawners, tempo tracking, statistics or a recorder can each consume the same
+ *  events at their own pace, batch them up or look back over the last BEAT_QUEUE_CAPACITY events without
+ *  running the detection again.
+ *
+ *  There is one writer and any number of readers, possibly on other threads. Nothing locks: the writer
+ *  never waits for the readers and simply overwrites the oldest event when the ring is full. Each slot
+ *  carries a version that is odd while it is being written, so a reader that is lapped notices, counts the
+ *  events it missed and carries on from the oldest event still in the ring.
+ */
+
+#ifndef INC_BEATQUEUE_H_
+#define INC_BEATQUEUE_H_
+
+#include <stdint.h>
+#include <atomic>
+
+#define BEAT_QUEUE_CAPACITY 256  // must be a power of two
+#define BEAT_BAND_NONE -1        // band of an event that only carries the SDK's beat and onset flags
+
+typedef struct {
+    uint64_t timestamp;  // microseconds on the monotonic clock
+    int16_t band;        // frequency band that beat, BEAT_BAND_NONE when the local detector found nothing
+    uint8_t strength;    // sound power of the band
+    float intensity;     // 0 to 1, log scaled against the band's running maximum
+    bool isBeat;         // getIsBeat() for the frame the event came from
+    bool isOnset;        // getIsOnset() for the frame the event came from
+} beat_event_t;
+
+/** A reader's position in the queue */
+typedef struct {
+    uint64_t next;       // sequence number of the next event to read
+    uint64_t dropped;    // events that were overwritten before this reader got to them
+} beat_cursor_t;
+
+class BeatQueue {
+public:
+    BeatQueue();
+
+    /** @description: forget every event, cursors taken before this must be taken again */
+    void clear();
+
+    /** @description: add an event, overwriting the oldest one when full. Only one thread may push */
+    void push(const beat_event_t& event);
+
+    /**
+     * @description: a new reader
+     * @param history: also return the events still in the ring, otherwise only the ones pushed from now on
+     */
+    beat_cursor_t subscribe(bool history) const;
+
+    /**
+     * @description: read the next event for a reader
+     * @return: false when the reader has seen every event
+     */
+    bool poll(beat_cursor_t* cursor, beat_event_t* event) const;
+
+    /** @description: number of events pushed so far */
+    uint64_t pushed() const { return head.load(std::memory_order_acquire); }
+
+    /** @description: current time on the clock the timestamps use */
+    static uint64_t now();
+
+private:
+    struct slot_t {
+        std::atomic<uint64_t> version;  // 2 * sequence + 2 once written, odd while being written
+        beat_event_t event;
+    };
+
+    slot_t ring[BEAT_QUEUE_CAPACITY];
+    std::atomic<uint64_t> head;  // sequence number of the next event to push
+};
+
+#endif /* INC_BEATQUEUE_H_ */
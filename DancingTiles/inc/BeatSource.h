@@ -0,0 +1,88 @@
+/*
+ * BeatSource.h
+ *
+ *  Description:
+ *  Where the beats come from. The SDK has its own beat and onset flags (getIsBeat(), getIsOnset()), and
+ *  the plugin has its own detector that runs on every FFT band. A BeatSource runs one of three modes and
+ *  pushes what it finds into a BeatQueue:
+ *
+ *      BEAT_SOURCE_SDK:    only the SDK's beat flag; the event goes to the loudest band. The per band
+ *                          detector does not run at all, which is the cheapest mode.
+ *      BEAT_SOURCE_LOCAL:  only the per band detector, the SDK flags are just recorded in the events.
+ *      BEAT_SOURCE_FUSED:  the per band detector, but a band beat only counts if the SDK saw an onset in
+ *                          the last BEAT_FUSION_WINDOW frames. Keeps the band colours of the local detector
+ *                          and drops its false positives in sustained loud passages.
+ */
+
+#ifndef INC_BEATSOURCE_H_
+#define INC_BEATSOURCE_H_
+
+#include "BeatQueue.h"
+#include "BandHistory.h"
+#include <stdint.h>
+#include <vector>
+
+#define BEAT_FUSION_WINDOW 2  // frames an SDK onset keeps the gate open for band beats in BEAT_SOURCE_FUSED
+#define MINIMUM_INTENSITY 0.2  // the minimum intensity of a beat
+#define TRIGGER_THRESHOLD 0.7 // used to calculate whether a band beat
+#define BAND_HISTORY_LOG2 6 // the band history holds the last 2^BAND_HISTORY_LOG2 frames, 64 frames is about 3s
+#define BAND_HISTORY_EMA 0.1 // weight of the newest frame in the band history's exponential average
+
+enum BeatSourceMode {
+    BEAT_SOURCE_SDK,
+    BEAT_SOURCE_LOCAL,
+    BEAT_SOURCE_FUSED
+};
+
+/** Here we store the information accociated with each frequency bin. This
+ allows for tracking a degree of historical information.
+ */
+typedef struct {
+    uint32_t latest_minimum;
+    uint32_t soundPower;
+    int16_t colour;
+    uint32_t runningMax;
+    uint32_t runningMin;
+    uint32_t maximumTrigger;
+} freq_bin;
+
+class BeatSource {
+public:
+    BeatSource();
+
+    /**
+     * @description: reset the detector
+     * @param nBands: number of FFT bands
+     * @param mode: where the beats come from
+     */
+    void init(int nBands, BeatSourceMode mode);
+
+    /**
+     * @description: look for beats in one frame and push them into the queue
+     * @param fftBins: nBands FFT values
+     * @param isBeat, isOnset: the SDK's flags for this frame
+     * @param now: timestamp for the events
+     * @param queue: where the events go
+     * @return: number of events pushed
+     */
+    int detect(const uint8_t* fftBins, bool isBeat, bool isOnset, uint64_t now, BeatQueue* queue);
+
+    /**
+     * @description: the recent FFT frames, for anything that wants windowed statistics of the bands. Not
+     * kept in BEAT_SOURCE_SDK, which does no per band work at all
+     */
+    const BandHistory& history() const { return bandHistory; }
+
+    BeatSourceMode mode;
+
+private:
+    bool detectBand(int i);
+    float intensity(int i) const;
+
+    std::vector<freq_bin> freqBins;  // per band state of the local detector
+    BandHistory bandHistory;
+    int nBands;
+    int framesSinceOnset;
+};
+
+#endif /* INC_BEATSOURCE_H_ */
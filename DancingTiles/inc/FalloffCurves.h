@@ -0,0 +1,128 @@
+/*
+ * FalloffCurves.h
+ *
+ *  Description:
+ *  How much of a light source's colour reaches a panel, as a function of the distance between them. Every
+ *  curve works on the squared distance, so no square root is needed, and is set up once per frame with
+ *  1 / pitch^2 (pitch being the distance between adjacent panels) and the diffusion multiplier. Curves are
+ *  small classes with the same members, picked as a template parameter by the code that uses them, so
+ *  there is no runtime dispatch:
+ *
+ *      void setup(float invPitch2, float multiplier)   once per frame
+ *      float atPitches(float d2) const                 factor at a squared distance in pitches, 0 to 1
+ *      float at(float d2) const                        factor at a squared distance in layout units
+ *      float cutoff2() const                           squared distance (layout units) beyond which the
+ *                                                      factor is 0, or below FALLOFF_EPSILON, so sources
+ *                                                      that far away can be skipped
+ *
+ *  InverseSquareFalloff   1 / (d^2 * multiplier + 1), what DancingTiles always used
+ *  GaussianFalloff        exp(-d^2 * multiplier / 2), from a lookup table
+ *  SmoothstepFalloff      smoothstep from 1 at the source to 0 at FALLOFF_RADIUS / multiplier pitches
+ *  LinearFalloff          1 - d / (FALLOFF_RADIUS / multiplier) down to 0
+ */
+
+#ifndef INC_FALLOFFCURVES_H_
+#define INC_FALLOFFCURVES_H_
+
+#include <math.h>
+
+#define FALLOFF_EPSILON (1.0f / 255)   // factors below this cannot change a colour channel
+#define FALLOFF_RADIUS 4.0f            // reach of the curves with a hard edge, in pitches at multiplier 1
+#define FALLOFF_LUT_SIZE 1024          // entries in the exp lookup table
+#define FALLOFF_LUT_RANGE 8.0f         // the table covers exp(-x) for x in 0..FALLOFF_LUT_RANGE
+
+extern float falloffExpLut[FALLOFF_LUT_SIZE + 1];  // exp(-x) at FALLOFF_LUT_RANGE / FALLOFF_LUT_SIZE steps
+
+/** Common part of the curves: the squared distance in layout units is turned into pitches */
+struct FalloffBase {
+    float invPitch2;
+    float multiplier;
+    float cutoffPitches2;  // the cutoff in pitches^2
+
+    void setup(float invPitch2, float mult) {
+        this->invPitch2 = invPitch2;
+        multiplier = mult;
+    }
+
+    float cutoff2() const {
+        return cutoffPitches2 / invPitch2;
+    }
+};
+
+struct InverseSquareFalloff : FalloffBase {
+    void setup(float invPitch2, float mult) {
+        FalloffBase::setup(invPitch2, mult);
+        cutoffPitches2 = (1 / FALLOFF_EPSILON - 1) / multiplier;
+    }
+
+    float atPitches(float d2) const {
+        return 1.0f / (d2 * multiplier + 1.0f);
+    }
+
+    float at(float d2) const {
+        return atPitches(d2 * invPitch2);
+    }
+};
+
+struct GaussianFalloff : FalloffBase {
+    float scale;  // squared distance in pitches to table index
+
+    void setup(float invPitch2, float mult) {
+        FalloffBase::setup(invPitch2, mult);
+        cutoffPitches2 = 2 * -logf(FALLOFF_EPSILON) / multiplier;
+        scale = multiplier * 0.5f * FALLOFF_LUT_SIZE / FALLOFF_LUT_RANGE;
+    }
+
+    float atPitches(float d2) const {
+        float index = d2 * scale;
+        return index < FALLOFF_LUT_SIZE ? falloffExpLut[(int)(index + 0.5f)] : 0.0f;
+    }
+
+    float at(float d2) const {
+        return atPitches(d2 * invPitch2);
+    }
+};
+
+struct SmoothstepFalloff : FalloffBase {
+    float invRadius2;
+
+    void setup(float invPitch2, float mult) {
+        FalloffBase::setup(invPitch2, mult);
+        float radius = FALLOFF_RADIUS / multiplier;
+        cutoffPitches2 = radius * radius;
+        invRadius2 = 1 / cutoffPitches2;
+    }
+
+    /** smoothstep in the squared distance, which keeps it free of square roots and still flat at both ends */
+    float atPitches(float d2) const {
+        float t = d2 * invRadius2;
+        t = t < 1.0f ? t : 1.0f;
+        return 1.0f - t * t * (3.0f - 2.0f * t);
+    }
+
+    float at(float d2) const {
+        return atPitches(d2 * invPitch2);
+    }
+};
+
+struct LinearFalloff : FalloffBase {
+    float invRadius;
+
+    void setup(float invPitch2, float mult) {
+        FalloffBase::setup(invPitch2, mult);
+        float radius = FALLOFF_RADIUS / multiplier;
+        cutoffPitches2 = radius * radius;
+        invRadius = 1 / radius;
+    }
+
+    float atPitches(float d2) const {
+        float f = 1.0f - sqrtf(d2) * invRadius;
+        return f > 0.0f ? f : 0.0f;
+    }
+
+    float at(float d2) const {
+        return atPitches(d2 * invPitch2);
+    }
+};
+
+#endif /* INC_FALLOFFCURVES_H_ */
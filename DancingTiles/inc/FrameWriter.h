@@ -0,0 +1,79 @@
+/*
+ * FrameWriter.h
+ *
+ *  Description:
+ *  Colour output as planes. Render code writes each panel's colour into separate R, G and B byte arrays
+ *  (in PanelOrder order), which keeps the render loops simple and vectorizable, and does not touch Frame_t
+ *  at all. write() then fills the Frame_t buffer in one streaming pass, taking the panel ids and transition
+ *  times from arrays worked out at init.
+ *
+ *  With adaptive transitions on, write() only sends the panels that need it. It keeps a model of what the
+ *  controller is showing on each panel: the controller fades linearly from the colour it showed when an
+ *  update came in to the update's colour over its transTime. A panel is left alone while the model stays
+ *  within a tolerance of the rendered colour, or while the fade in flight is already heading for it. When a
+ *  panel does need an update and its colour has been moving steadily, the update aims at where the colour
+ *  will be a few frames on with a matching longer transTime, so a slow fade costs one update instead of one
+ *  per frame. Colours that jump about get the plain transition time, as without adaptive transitions.
+ */
+
+#ifndef INC_FRAMEWRITER_H_
+#define INC_FRAMEWRITER_H_
+
+#include "AuroraPlugin.h"
+#include "PanelOrder.h"
+#include <stdint.h>
+#include <vector>
+
+class FrameWriter {
+public:
+    FrameWriter();
+
+    /**
+     * @description: size the planes for a layout and set every panel's transition time
+     * @param order: the panels, in the order the planes are indexed
+     * @param transTime: transition time for every panel, in multiples of 100ms
+     */
+    void init(const PanelOrder& order, int transTime);
+
+    /**
+     * @description: only send panels whose colour the controller would otherwise get wrong
+     * @param tolerance: largest difference on any channel between the rendered and the shown colour
+     * @param maxTransTime: longest transition used for a steady fade, in multiples of 100ms
+     * @param frameTime: time between two write() calls, in multiples of 100ms
+     * @param refreshFrames: every panel is sent at least once every this many frames anyway
+     */
+    void enableAdaptive(int tolerance, int maxTransTime, float frameTime, int refreshFrames);
+
+    /** @description: convert float planes to the byte planes, clamped to 0..255, after adding an offset */
+    void fromFloat(const float* srcR, const float* srcG, const float* srcB, float offsetR, float offsetG, float offsetB);
+
+    /**
+     * @description: fill the frame buffer
+     * @return: the number of frames written, nPanels unless adaptive transitions are on
+     */
+    int write(Frame_t* frames);
+
+    int nPanels;
+    std::vector<uint8_t> R, G, B;   // colour of each panel, in PanelOrder order
+    std::vector<int> panelId;       // id of each panel
+    std::vector<int> transTime;     // transition time of each panel
+
+private:
+    int writeAdaptive(Frame_t* frames);
+
+    bool adaptive;
+    int tolerance;
+    int maxTransTime;
+    float frameTime;
+    int refreshFrames;
+    int frame;                          // number of write() calls so far
+    // the model of each panel on the controller: a fade from start to target over fadeFrames frames
+    std::vector<float> startR, startG, startB;
+    std::vector<float> targetR, targetG, targetB;
+    std::vector<int> fadeStart;         // frame the fade was sent
+    std::vector<float> fadeFrames;
+    std::vector<uint8_t> lastR, lastG, lastB;  // rendered colour of the previous frame, for the velocity
+    std::vector<float> lastVelocityR, lastVelocityG, lastVelocityB;
+};
+
+#endif /* INC_FRAMEWRITER_H_ */
@@ -0,0 +1,52 @@
+/*
+ * InitScheduler.h
+ *
+ *  Description:
+ *  Runs the slow part of initPlugin() (derived tables: adjacency, hop distances, glow buffers, ...) on a
+ *  background thread so the plugin loads straight away, however big the layout. Until the tables are done
+ *  getPluginFrame() keeps to a cheaper path that doesn't need them and checks ready() every frame; ready()
+ *  only turns true after everything the task wrote is visible to the frame thread, so the switch over is a
+ *  single flag and needs no locking. The frame thread must not touch the task's tables before that.
+ *
+ *  If no thread can be started the task simply runs in start(), which is logged the first time it happens.
+ *  Plugins using this must be compiled with -pthread and linked with -lpthread.
+ */
+
+#ifndef INC_INITSCHEDULER_H_
+#define INC_INITSCHEDULER_H_
+
+#include <atomic>
+#include <thread>
+
+class InitScheduler {
+public:
+    InitScheduler();
+
+    /** @description: waits for a task that is still running */
+    ~InitScheduler();
+
+    /**
+     * @description: run the task, waiting first for the previous one if it hasn't finished
+     * @param task: builds the tables
+     * @param background: false runs the task right away, before start() returns
+     */
+    void start(void (*task)(), bool background);
+
+    /** @description: true once the last task started has finished */
+    bool ready() const { return done.load(std::memory_order_acquire); }
+
+    /** @description: block until the task has finished */
+    void wait();
+
+    /** @description: how long the last task took, in ms */
+    float elapsed() const { return elapsedMs; }
+
+private:
+    static void run(InitScheduler* scheduler, void (*task)());
+
+    std::thread worker;
+    std::atomic<bool> done;
+    float elapsedMs;
+};
+
+#endif /* INC_INITSCHEDULER_H_ */
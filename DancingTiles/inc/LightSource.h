@@ -0,0 +1,23 @@
+/*
+ * LightSource.h
+ *
+ *  Description:
+ *  The light source record shared by the plugin and the spatial structures built over the source list.
+ */
+
+#ifndef INC_LIGHTSOURCE_H_
+#define INC_LIGHTSOURCE_H_
+
+// Here we store the information accociated with each light source like current
+// position, velocity and colour. The information is stored in a list called sources.
+typedef struct {
+    float x;
+    float y;
+    int R;
+    int G;
+    int B;
+    int age;
+    int panel; // the panel the source was spawned on, as an index into the PanelOrder arrays
+} source_t;
+
+#endif /* INC_LIGHTSOURCE_H_ */
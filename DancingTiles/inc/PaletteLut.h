@@ -0,0 +1,58 @@
+/*
+ * PaletteLut.h
+ *
+ *  Description:
+ *  Colour lookup tables built from the palette once at init, so picking a colour in the beat path is a
+ *  byte indexed lookup instead of float maths on the palette.
+ *
+ *  band tables: for every frequency band, 256 colours from black (intensity 0) up to the band's colour
+ *  (intensity 255).
+ *
+ *  With perceptual interpolation the blending happens in linear light (gamma 2.2 removed) rather than on
+ *  the raw sRGB values, so the midpoint between two colours does not dip in brightness.
+ */
+
+#ifndef INC_PALETTELUT_H_
+#define INC_PALETTELUT_H_
+
+#include "ColorUtils.h"
+#include <stdint.h>
+#include <vector>
+
+#define PALETTE_LUT_SIZE 256
+
+typedef struct {
+    uint8_t R, G, B;
+} lut_colour_t;
+
+class PaletteLut {
+public:
+    PaletteLut();
+
+    /**
+     * @description: build the tables
+     * @param palette: the palette colours
+     * @param nColours: number of colours in the palette
+     * @param nBands: number of frequency bands, band b gets palette colour b (the bands are spread out
+     *        along the palette if there are not as many bands as colours)
+     * @param perceptual: interpolate in linear light instead of sRGB
+     */
+    void build(const RGB_t* palette, int nColours, int nBands, bool perceptual);
+
+    /** @description: colour of band at an intensity, 0 is black and 255 the full band colour */
+    const lut_colour_t& band(int band, uint8_t intensity) const { return bands[band * PALETTE_LUT_SIZE + intensity]; }
+
+    /** @description: turn an intensity in [0, 1] into a table index */
+    static uint8_t intensityIndex(float intensity) {
+        return intensity <= 0 ? 0 : intensity >= 1 ? 255 : (uint8_t)(intensity * 255 + 0.5f);
+    }
+
+private:
+    lut_colour_t mix(const RGB_t& a, const RGB_t& b, float t, bool perceptual) const;
+    lut_colour_t mixAlong(const RGB_t* palette, int nColours, float t, bool perceptual) const;
+
+    std::vector<lut_colour_t> bands;   // nBands * PALETTE_LUT_SIZE
+    float toLinear[256];               // sRGB byte to linear light
+};
+
+#endif /* INC_PALETTELUT_H_ */
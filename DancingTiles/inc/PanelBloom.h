@@ -0,0 +1,54 @@
+/*
+ * PanelBloom.h
+ *
+ *  Description:
+ *  Glow as a post-process over the panel adjacency graph. Light sources only light up the panel they sit
+ *  on; then each pass adds a fraction of every panel's neighbours to it:
+ *
+ *      next[i] = current[i] + spread * sum over neighbours j (current[j]) / maxDegree
+ *
+ *  so after n passes the glow reaches n panels out, fading with every hop. maxDegree is the most neighbours
+ *  any panel in the graph has (3 for triangles, 4 for squares, more for other polygons), so even a fully
+ *  surrounded panel gains at most spread times its brightest neighbour per pass. The colour planes are separate
+ *  R, G and B arrays in PanelOrder order and a pass is one sweep over the CSR neighbour lists, so a halo
+ *  costs O(edges * passes) however many sources there are.
+ */
+
+#ifndef INC_PANELBLOOM_H_
+#define INC_PANELBLOOM_H_
+
+#include "PanelGraph.h"
+#include <vector>
+
+class PanelBloom {
+public:
+    PanelBloom();
+
+    /** @description: size the colour planes for the graph, which must outlive the bloom */
+    void init(const PanelGraph* graph);
+
+    /** @description: turn every panel off; the glow is light added on top of the background */
+    void clear();
+
+    /**
+     * @description: mix a light source into the panel it sits on, the same way renderPanel mixes sources in
+     * @param factor: how much of the source's colour replaces what is there, 0 - 1
+     */
+    void emit(int panel, float R, float G, float B, float factor);
+
+    /**
+     * @description: spread the light out to the neighbouring panels
+     * @param passes: how many panels out the glow reaches
+     * @param spread: fraction of the neighbours' light added per pass
+     */
+    void spread(int passes, float spread);
+
+    std::vector<float> R, G, B;
+
+private:
+    const PanelGraph* graph;
+    int maxDegree;              // most neighbours of any panel, at least 1
+    std::vector<float> nextR, nextG, nextB;
+};
+
+#endif /* INC_PANELBLOOM_H_ */
@@ -0,0 +1,103 @@
+/*
+ * PanelGeometry.h
+ *
+ *  Description:
+ *  The panel outlines, set up for fast geometry. The SDK keeps every panel behind a Shape* and answers point
+ *  tests through a virtual isPointInsideShape(). PanelGeometry reads the outlines once and sorts the panels
+ *  into one bucket per shape type, each stored as a flat array of a small struct with what that shape's test
+ *  needs precomputed:
+ *
+ *      SHAPE_TRIANGLE  triangle_t  barycentric coordinates against the first corner
+ *      SHAPE_SQUARE    square_t    the point turned into the square's own frame, then a box test
+ *      SHAPE_RHYTHM    polygon_t   the Rhythm module (and any other outline) as a convex polygon, one
+ *                                  half plane test per side
+ *
+ *  The point test, the corners and the bounding box are overloaded functions per struct, and every operation
+ *  below is a template run once per bucket, so the shape is known at compile time in the inner loops and no
+ *  indirect call is made. Mixed layouts just have more than one non-empty bucket.
+ *
+ *  Panels are identified by their index in layoutData->panels.
+ */
+
+#ifndef INC_PANELGEOMETRY_H_
+#define INC_PANELGEOMETRY_H_
+
+#include "LayoutProcessingUtils.h"
+#include <vector>
+
+#define GEOMETRY_MAX_VERTICES 8   // outlines with more corners than this are cut short
+#define EDGE_TOLERANCE 0.1        // edges whose midpoints are within 10% of their length count as shared
+
+typedef struct {
+    float minX, minY, maxX, maxY;
+} geometry_box_t;
+
+typedef struct {
+    float ax, ay;               // first corner
+    float v0x, v0y, v1x, v1y;   // the two sides from the first corner
+    float d00, d01, d11;        // their dot products
+    float invDenom;             // 1 / (d00 * d11 - d01 * d01)
+    float cx[3], cy[3];         // corners
+} triangle_t;
+
+typedef struct {
+    float cx, cy;               // centre
+    float ux, uy;               // unit vector along the first side
+    float half;                 // half the side length
+} square_t;
+
+typedef struct {
+    int n;                      // number of corners
+    float x[GEOMETRY_MAX_VERTICES], y[GEOMETRY_MAX_VERTICES];
+    float sign;                 // 1 for anticlockwise corners, -1 for clockwise
+} polygon_t;
+
+/** One shape type's panels */
+template<class T>
+struct geometry_bucket_t {
+    std::vector<T> shapes;
+    std::vector<geometry_box_t> boxes;
+    std::vector<int> panel;     // index in layoutData->panels
+};
+
+class PanelGeometry {
+public:
+    PanelGeometry();
+
+    /** @description: read the outlines of the layout */
+    void build(LayoutData* layoutData);
+
+    /** @description: index of the panel the point lies in, -1 if none */
+    int panelAt(float x, float y) const;
+
+    /**
+     * @description: assign the cells of a square lattice to the panels their centres lie in. A cell on the
+     * border of two panels goes to the one with the lower index, as if the panels were tested in order.
+     * @param originX, originY: corner of the lattice in layout coordinates
+     * @param cellSize: size of a cell in layout coordinates
+     * @param size: the lattice is size x size cells
+     * @param cellPanel: size * size entries, set to the panel of each cell or left as they are
+     * @param panelCells: nPanels counts, incremented for every cell a panel gets
+     */
+    void rasterize(float originX, float originY, float cellSize, int size,
+                   std::vector<int>* cellPanel, std::vector<int>* panelCells) const;
+
+    /**
+     * @description: find the panels that share a side
+     * @return: in neighbours[i] the panels sharing a side with panel i, sorted
+     */
+    void adjacency(std::vector<std::vector<int> >* neighbours) const;
+
+    /** @description: bounding box of the whole layout */
+    geometry_box_t bounds() const { return layoutBox; }
+
+    int nPanels;
+    geometry_bucket_t<triangle_t> triangles;
+    geometry_bucket_t<square_t> squares;
+    geometry_bucket_t<polygon_t> polygons;
+
+private:
+    geometry_box_t layoutBox;
+};
+
+#endif /* INC_PANELGEOMETRY_H_ */
@@ -0,0 +1,74 @@
+/*
+ * PanelGraph.h
+ *
+ *  Description:
+ *  Panel adjacency graph and hop distances over it. Two panels are neighbours when they share a side (as
+ *  found by PanelGeometry), so mixed layouts of triangles, squares and Rhythm modules need no panel pitch.
+ *  The neighbour lists are stored in CSR form (all neighbour lists back to back in one array, with an offset
+ *  per panel) so sweeps over every edge run through memory in order.
+ *
+ *  Hop distances are the number of panels you have to walk over to get from one panel to another, i.e. the
+ *  distance along the shape of the layout rather than through the gaps of a non-convex one. They are kept
+ *  as uint8 (saturating at GEODESIC_UNREACHABLE) in a full matrix for small layouts and as cached rows,
+ *  filled in on demand with a breadth first search, for big ones.
+ *
+ *  Panel indices are positions in the PanelOrder arrays.
+ */
+
+#ifndef INC_PANELGRAPH_H_
+#define INC_PANELGRAPH_H_
+
+#include "PanelGeometry.h"
+#include "PanelOrder.h"
+#include <stdint.h>
+#include <vector>
+
+#define GEODESIC_UNREACHABLE 255        // hop distance of panels that are not connected (or too far apart)
+#define GEODESIC_ALL_PAIRS_MAX 2048     // layouts up to this size get the full matrix (4MB at the limit)
+
+class PanelGraph {
+public:
+    PanelGraph();
+
+    /**
+     * @description: find the neighbours of every panel
+     * @param order: the flattened layout
+     * @param geometry: the same layout, built with PanelGeometry::build
+     */
+    void build(const PanelOrder& order, const PanelGeometry& geometry);
+
+    /**
+     * @description: set up the hop distance storage, only needed if row() is going to be used.
+     * Fills in the full matrix straight away for layouts up to GEODESIC_ALL_PAIRS_MAX panels.
+     */
+    void buildHopDistances();
+
+    /**
+     * @description: must be called once per frame before row(). Rows handed out in the previous frame may be
+     * recycled after this call.
+     */
+    void beginFrame();
+
+    /**
+     * @description: hop distances from the given panel to every other panel
+     * @return: nPanels entries, valid until the next beginFrame()
+     */
+    const uint8_t* row(int origin);
+
+    int nPanels;
+    std::vector<int> offsets;      // neighbours of panel i are neighbours[offsets[i]] .. neighbours[offsets[i+1]-1]
+    std::vector<int> neighbours;
+
+private:
+    void fillRow(int origin, uint8_t* out);
+
+    std::vector<uint8_t> allPairs;          // nPanels * nPanels, empty for big layouts
+    std::vector<std::vector<uint8_t> > cachedRows;
+    std::vector<int> cachedOrigin;
+    std::vector<int> cachedFrame;           // the last frame each cached row was used in
+    std::vector<int> originSlot;            // cache slot holding each origin's row, -1 if not cached
+    std::vector<int> queue;
+    int frame;
+};
+
+#endif /* INC_PANELGRAPH_H_ */
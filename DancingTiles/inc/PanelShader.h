@@ -0,0 +1,107 @@
+/*
+ * PanelShader.h
+ *
+ *  Description:
+ *  Runs an effect over every panel the way a GPU runs a shader. The effect is a kernel class that splits
+ *  its work in two: values that are the same for every panel in a frame (tempo multipliers, tables, the
+ *  source list) go into a uniform block that is filled once per frame, and the per panel work reads only
+ *  from that block. A kernel looks like
+ *
+ *      struct MyKernel {
+ *          struct uniforms_t { ... };
+ *          void uniforms(uniforms_t* u) const;    // once per frame
+ *          int items(const uniforms_t& u) const;  // things mixed into every panel, e.g. light sources
+ *          void base(const uniforms_t& u, int panel, float x, float y, float* R, float* G, float* B) const;
+ *          void mix(const uniforms_t& u, int item, int panel, float x, float y, float* R, float* G, float* B) const;
+ *          bool culled(const uniforms_t& u, int item, float minX, float minY, float maxX, float maxY) const;
+ *      };
+ *
+ *  base() gives a panel's starting colour and mix() adds one item to it. shadePanels() walks the panels in
+ *  blocks of PANEL_SHADER_BLOCK and, for every item, runs mix() over the whole block before going on to the
+ *  next item. The kernel is a template parameter, so mix() is inlined into a loop over contiguous panel
+ *  arrays which the compiler can vectorize, and the uniforms stay in registers. Every panel still sees the
+ *  items in order, so the result is the same as mixing them panel by panel. culled() is asked once per item
+ *  and block with the bounding box of the block's centroids; an item that cannot reach any of them (a light
+ *  source beyond the cutoff of its falloff curve) is skipped for the whole block. Blocks are runs of the
+ *  Hilbert order, so their boxes are small. With nThreads > 1 the blocks are shared out between threads;
+ *  there is no pool, the nThreads - 1 extra threads are started and joined on every call, which costs tens
+ *  of microseconds per thread per frame and only pays off when a frame's shading takes much longer than that.
+ */
+
+#ifndef INC_PANELSHADER_H_
+#define INC_PANELSHADER_H_
+
+#include "PanelOrder.h"
+#include <stdint.h>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#define PANEL_SHADER_BLOCK 64  // panels per block, the colour accumulators of a block stay in L1
+
+/** shade the blocks first, first + step, first + 2 * step, ... */
+template<class Kernel>
+void shadeBlocks(const Kernel& kernel, const typename Kernel::uniforms_t& u, const PanelOrder& order,
+                 int first, int step, uint8_t* outR, uint8_t* outG, uint8_t* outB) {
+    float R[PANEL_SHADER_BLOCK], G[PANEL_SHADER_BLOCK], B[PANEL_SHADER_BLOCK];
+    int nItems = kernel.items(u);
+    for(int start = first * PANEL_SHADER_BLOCK; start < order.nPanels; start += step * PANEL_SHADER_BLOCK) {
+        int n = order.nPanels - start < PANEL_SHADER_BLOCK ? order.nPanels - start : PANEL_SHADER_BLOCK;
+        const float* x = &order.x[start];
+        const float* y = &order.y[start];
+        float minX = x[0], minY = y[0], maxX = x[0], maxY = y[0];
+        for(int p = 0; p < n; p++) {
+            kernel.base(u, start + p, x[p], y[p], &R[p], &G[p], &B[p]);
+            minX = x[p] < minX ? x[p] : minX;
+            maxX = x[p] > maxX ? x[p] : maxX;
+            minY = y[p] < minY ? y[p] : minY;
+            maxY = y[p] > maxY ? y[p] : maxY;
+        }
+        for(int item = 0; item < nItems; item++) {
+            if(kernel.culled(u, item, minX, minY, maxX, maxY)) {
+                continue;
+            }
+            for(int p = 0; p < n; p++) {
+                kernel.mix(u, item, start + p, x[p], y[p], &R[p], &G[p], &B[p]);
+            }
+        }
+        for(int p = 0; p < n; p++) {
+            outR[start + p] = (int)R[p];
+            outG[start + p] = (int)G[p];
+            outB[start + p] = (int)B[p];
+        }
+    }
+}
+
+/**
+ * @description: fill the uniforms and run a kernel over every panel
+ * @param kernel: the effect
+ * @param order: the panels, the output planes are indexed in this order
+ * @param outR, outG, outB: the colour of each panel, the kernel's colours are truncated to bytes
+ * @param nThreads: number of threads to spread the panels over
+ */
+template<class Kernel>
+void shadePanels(const Kernel& kernel, const PanelOrder& order, uint8_t* outR, uint8_t* outG, uint8_t* outB, int nThreads) {
+    typename Kernel::uniforms_t u;
+    kernel.uniforms(&u);
+    int nBlocks = (order.nPanels + PANEL_SHADER_BLOCK - 1) / PANEL_SHADER_BLOCK;
+    if(nThreads > nBlocks) {
+        nThreads = nBlocks;
+    }
+    if(nThreads <= 1) {
+        shadeBlocks(kernel, u, order, 0, 1, outR, outG, outB);
+        return;
+    }
+    // blocks are dealt out round robin, neighbouring blocks cost about the same
+    std::vector<std::thread> threads;
+    for(int t = 1; t < nThreads; t++) {
+        threads.push_back(std::thread(shadeBlocks<Kernel>, std::cref(kernel), std::cref(u), std::cref(order),
+                                      t, nThreads, outR, outG, outB));
+    }
+    shadeBlocks(kernel, u, order, 0, nThreads, outR, outG, outB);
+    for(size_t t = 0; t < threads.size(); t++) {
+        threads[t].join();
+    }
+}
+
+#endif /* INC_PANELSHADER_H_ */
@@ -0,0 +1,33 @@
+/*
+ * PhaseMarks.h
+ *
+ *  Description:
+ *  Marks the stages of a frame for the host benches (see Bench/inc/HostSdk.h), so perfBench can charge
+ *  time and hardware counters to detecting, spawning, rendering and writing instead of to the plugin as a
+ *  whole. hostMarkPhase is a weak symbol only the bench programs define; on the device it resolves to
+ *  NULL and markPhase() is a compare and a branch.
+ *
+ *  A mark holds until the next one, so every stretch has to end with markPhase(PHASE_MARK_NONE).
+ */
+
+#ifndef INC_PHASEMARKS_H_
+#define INC_PHASEMARKS_H_
+
+// the same numbers as hostMarkPhase's marks in HostSdk.h
+typedef enum {
+    PHASE_MARK_NONE = 0,    // back to the plugin's own code
+    PHASE_MARK_DETECT,      // beat detection
+    PHASE_MARK_SPAWN,       // turning beats into light sources
+    PHASE_MARK_RENDER,      // shading the panels
+    PHASE_MARK_WRITE        // filling in the frames
+} phase_mark_t;
+
+extern "C" void hostMarkPhase(int mark) __attribute__((weak));
+
+inline void markPhase(phase_mark_t mark) {
+    if(hostMarkPhase) {
+        hostMarkPhase(mark);
+    }
+}
+
+#endif /* INC_PHASEMARKS_H_ */
@@ -0,0 +1,85 @@
+/*
+ * SourceQuadTree.h
+ *
+ *  Description:
+ *  Barnes-Hut style quadtree over the light sources. Every node keeps the number of sources below it,
+ *  their mean position and their summed colour, so a cluster of sources that is far away from a panel
+ *  (compared to its own size) can be mixed in as a single pseudo-source. Rendering a panel then costs
+ *  roughly O(log nSources) instead of O(nSources).
+ *
+ *  Mixing a source into a colour depends on the order the sources come in (the last one has the most
+ *  weight), and the source list is oldest first. So what a panel sees of the tree, single sources and
+ *  pseudo-sources alike, is mixed in by age, a pseudo-source at the mean age of its sources. With theta 0
+ *  nothing is approximated and the result is exactly that of mixing the sources in one by one.
+ *
+ *  DancingTiles only uses the tree from BARNES_HUT_MIN_SOURCES sources on. Its shipped settings (sources
+ *  that live a frame or two, one per band that beats) never keep that many alive, so the tree is for
+ *  configurations with long lived or many sources.
+ */
+
+#ifndef INC_SOURCEQUADTREE_H_
+#define INC_SOURCEQUADTREE_H_
+
+#include "LightSource.h"
+#include <vector>
+
+#define QUADTREE_LEAF_SIZE 8    // nodes holding this many sources or less are not split any further
+#define QUADTREE_MAX_DEPTH 16   // stops the split when many sources sit on (almost) the same point
+
+typedef struct {
+    float minX, minY, maxX, maxY; // tight bounding box of the sources below this node
+    float x, y;                   // mean position of the sources below this node
+    float R, G, B;                // mean colour of the sources below this node
+    float age;                    // mean position of the sources below this node in the source list
+    int count;                    // number of sources below this node
+    int begin, end;               // range of this node's sources in the index list
+    int child[4];                 // indices of the child nodes, -1 if there is no child
+} quad_node_t;
+
+// a source or a pseudo-source a panel sees, collected so they can be mixed in by age
+typedef struct {
+    float age;
+    float d2;
+    float R, G, B;
+    int count;
+} quad_contribution_t;
+
+class SourceQuadTree {
+public:
+    SourceQuadTree();
+
+    /**
+     * @description: rebuild the tree over the given list of sources. Must be called every time the
+     * source list changes; the tree keeps a pointer to the list but does not copy it.
+     * @param sources: the list of light sources
+     * @param nSources: the number of light sources in the list
+     */
+    void build(const source_t* sources, int nSources);
+
+    /**
+     * @description: mix the colour of all sources into the given accumulator as seen from point (px, py).
+     * A node is opened when size / distance >= theta, otherwise its sources are mixed in as one pseudo-source.
+     * theta = 0 visits every source, larger values trade accuracy for speed (0.5 is the usual choice).
+     * Uses the inverse square falloff: factor = 1 / (d^2 * invPitch2 * multiplier + 1).
+     * @param px, py: the point to render, normally a panel centroid
+     * @param invPitch2: 1 / ADJACENT_PANEL_DISTANCE^2
+     * @param multiplier: the diffusion multiplier
+     * @param theta: the opening angle
+     * @param R, G, B: the colour accumulator
+     */
+    void render(float px, float py, float invPitch2, float multiplier, float theta,
+                float* R, float* G, float* B) const;
+
+    int nodeCount() const { return (int)nodes.size(); }
+
+private:
+    int buildNode(int begin, int end, int depth);
+    void mix(float d2, float R, float G, float B, int count, float invPitch2, float multiplier,
+             float* accR, float* accG, float* accB) const;
+
+    const source_t* sources;
+    std::vector<int> index;          // source indices, ordered so every node owns a contiguous range
+    std::vector<quad_node_t> nodes;  // node 0 is the root
+};
+
+#endif /* INC_SOURCEQUADTREE_H_ */
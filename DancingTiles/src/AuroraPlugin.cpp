@@ -36,6 +36,20 @@
 #include <string.h>
 #include "Logger.h"
 #include "PluginFeatures.h"
+#include "LightSource.h"
+#include "SourceQuadTree.h"
+#include "PanelOrder.h"
+#include "PanelGraph.h"
+#include "InitScheduler.h"
+#include "PaletteLut.h"
+#include "PanelBloom.h"
+#include "BeatQueue.h"
+#include "BeatSource.h"
+#include "FrameWriter.h"
+#include "PanelShader.h"
+#include "FalloffCurves.h"
+#include "PhaseMarks.h"
+#include <vector>
 
 
 #ifdef __cplusplus
@@ -55,8 +69,15 @@ extern "C" {
 #define BASE_COLOUR_B 0
 #define ADJACENT_PANEL_DISTANCE 86.599995   // hard coded distance between adjacent panels; this ideally should be autodetected
 #define TRANSITION_TIME 1  // the transition time to send to panels; set to 100ms currently
-#define MINIMUM_INTENSITY 0.2  // the minimum intensity of a source
-#define TRIGGER_THRESHOLD 0.7 // used to calculate whether to add a source
+#define BEAT_SOURCE BEAT_SOURCE_LOCAL // where beats come from: BEAT_SOURCE_SDK, BEAT_SOURCE_LOCAL or BEAT_SOURCE_FUSED, see BeatSource.h
+#define ADAPTIVE_TRANSITIONS false // only send panels that need it, with longer transitions for steady fades, see FrameWriter.h
+#define ADAPTIVE_TOLERANCE 6 // how far off (out of 255, on any channel) a panel may be before it is sent again
+#define ADAPTIVE_MAX_TRANSITION_TIME 10 // longest transition for a steady fade, in multiples of 100ms
+#define FRAME_TIME 0.5 // time between frames in multiples of 100ms, sound plugins are called every 50ms
+#define ADAPTIVE_REFRESH_FRAMES 40 // every panel is sent at least this often anyway
+#define TRACE_BEATS false // log every frame's FFT and SDK beat flags as a TRACE line, for replaying in Bench/
+#define PERCEPTUAL_PALETTE false // blend palette colours in linear light instead of sRGB
+#define BACKGROUND_INIT true // build the panel graph and the other derived tables on a background thread, see InitScheduler.h
 //Light source consts
 #define SPAWN_AMOUNT 1
 #define LIFESPAN 1 //the max number of cycles a source will live
@@ -64,51 +85,49 @@ extern "C" {
 #define TEMPO_DIVISOR 25 //default is 25
 #define TEMPO_ENABLED false //determines if the tempo is taken into consideration for the diffusion
 #define MININMUM_MULTIPLIER 1.5//minimum multiplier value used. Default is 1.5
-
-// Here we store the information accociated with each light source like current
-// position, velocity and colour. The information is stored in a list called sources.
-typedef struct {
-    float x;
-    float y;
-    int R;
-    int G;
-    int B;
-    int age;
-} source_t;
-
-/** Here we store the information accociated with each frequency bin. This
- allows for tracking a degree of historical information.
- */
-typedef struct {
-    uint32_t latest_minimum;
-    uint32_t soundPower;
-    int16_t colour;
-    uint32_t runningMax;
-    uint32_t runningMin;
-    uint32_t maximumTrigger;
-    uint32_t previousPower;
-    uint32_t secondPreviousPower;
-} freq_bin;
+#define FALLOFF_CURVE InverseSquareFalloff //how the light of a source falls off: InverseSquareFalloff, GaussianFalloff, SmoothstepFalloff or LinearFalloff, see FalloffCurves.h
+#define PANEL_SHADER_THREADS 1 //number of threads the panels are rendered on, see PanelShader.h. Every thread past the first is
+                                //started and joined every frame, so more only pay off on big layouts
+//Barnes-Hut consts
+#define BARNES_HUT_MIN_SOURCES 64 //below this many sources every source is mixed in directly. At most about nColors * SPAWN_AMOUNT * (LIFESPAN + 1)
+                                 //sources are alive at once, 14 with the settings above, so the tree is only used once LIFESPAN or SPAWN_AMOUNT are raised
+#define BARNES_HUT_THETA 0.5 //opening angle, the error bound of the approximation. 0 is exact, larger is faster
+#define BARNES_HUT_CHECK false //every frame the tree renders, also render it at theta 0 and log how far it is from DistanceKernel (it has to be 0)
+//Geodesic consts
+#define GEODESIC_ENABLED true //measure the distance to a source by walking over the panels instead of in a straight line
+//Bloom consts
+#define BLOOM_ENABLED false //sources only light their own panel and the glow is spread over the panel graph afterwards
+#define BLOOM_PASSES 3 //how many panels out the glow reaches
+#define BLOOM_SPREAD 0.6 //fraction of the neighbours' light added to a panel per pass
 
 static RGB_t* palettenColors = NULL; // this is our saved pointer to the colour palette
 static int nColors = 0;             // the number of nColors in the palette
+static PaletteLut paletteLut; // the colour of every band at every intensity
 static LayoutData *layoutData; // this is our saved pointer to the panel layout information
+static PanelOrder panelOrder; // the layout flattened into arrays in Hilbert curve order
+static PanelGeometry panelGeometry; // the panel shapes, bucketed by shape type
+static PanelGraph panelGraph; // panel adjacency and hop distances, used for the geodesic distance
+static InitScheduler tableBuilder; // builds panelGeometry, panelGraph and bloom, nothing else may touch them until it's ready
+static bool tablesAnnounced = false;
+static PanelBloom bloom; // glow buffers for BLOOM_ENABLED
 static source_t* sources; // this is our array for sources
 static int nSources = 0;
-static freq_bin* freqBins; // this is our array for frequency bin historical information.
+static BeatSource beatSource; // the beat detector
+static SourceQuadTree sourceTree; // rebuilt every frame when there are enough sources to make it worth it
+static FrameWriter frameWriter; // the colour planes every render path writes to
+static BeatQueue beatQueue; // every beat detected, for anything that wants to react to them
+static beat_cursor_t spawnCursor; // where the light source spawner is in beatQueue
+static int warmupFrames = 0; // frames skipped so far, see SKIP_COUNT
 
 /**
-  * @description: add a value to a running max.
-  * @param: runningMax is current runningMax, valueToAdd is added to runningMax, effectiveTrail
-  *         defines how many values are effectively tracked. Note this is an approximation.
-  * @return: int returned as new runningMax.
-  */
-int addToRunningMax(int runningMax, int valueToAdd, int effectiveTrail) {
-    int trail = effectiveTrail;
-    if (valueToAdd > runningMax && effectiveTrail > 1) {
-        trail = trail / 2;
-    }
-    return runningMax - ((float)runningMax / effectiveTrail) + ((float)valueToAdd / trail);
+ * @description: everything the geodesic distance and the bloom need, run by tableBuilder. Frames are
+ * rendered with the straight line distance until it is done.
+ */
+void buildDerivedTables() {
+    panelGeometry.build(layoutData);
+    panelGraph.build(panelOrder, panelGeometry);
+    panelGraph.buildHopDistances();
+    bloom.init(&panelGraph);
 }
 
 /**
@@ -128,9 +147,10 @@ void initPlugin() {
 #define MAX_SOURCES layoutData->nPanels*LIFESPAN  // maxiumum sources
     PRINTLOG("MAX_SOURCES: %d\n", MAX_SOURCES);
 
-    if(nColors > MAX_PALETTE_nColors) {
+    // layouts of one or two panels would leave no colours at all, they get the first one
+    if(nColors > MAX_PALETTE_nColors && nColors > 1) {
         PRINTLOG("There are too many nColors in the palette. using only the first %d\n", MAX_PALETTE_nColors);
-        nColors = MAX_PALETTE_nColors;
+        nColors = MAX_PALETTE_nColors > 1 ? MAX_PALETTE_nColors : 1;
     }
     sources = new source_t[MAX_SOURCES];
     for (int i = 0; i < nColors; i++) {
@@ -143,15 +163,18 @@ void initPlugin() {
         PRINTLOG("   Id: %d   X, Y: %lf, %lf\n", layoutData->panels[i].panelId,
                layoutData->panels[i].shape->getCentroid().x, layoutData->panels[i].shape->getCentroid().y);
     }
+    panelOrder.build(layoutData);
+    tableBuilder.start(buildDerivedTables, BACKGROUND_INIT);
+    frameWriter.init(panelOrder, TRANSITION_TIME);
+    if(ADAPTIVE_TRANSITIONS) {
+        frameWriter.enableAdaptive(ADAPTIVE_TOLERANCE, ADAPTIVE_MAX_TRANSITION_TIME, FRAME_TIME, ADAPTIVE_REFRESH_FRAMES);
+    }
 
 
-    freqBins = new freq_bin[MAX_PALETTE_nColors];
-    // here we initialize our freqency bin values so that the plugin starts working reasonably well right away
-    for (int i = 0; i < nColors; i++) {
-        freqBins[i].latest_minimum = 0;
-        freqBins[i].runningMax = 50;//Default 3
-        freqBins[i].maximumTrigger = 1;//Default 1
-    }
+    beatSource.init(nColors, BEAT_SOURCE);
+    paletteLut.build(palettenColors, nColors, nColors, PERCEPTUAL_PALETTE);
+    beatQueue.clear();
+    spawnCursor = beatQueue.subscribe(false);
     enableFft(nColors);
     enableBeatFeatures();
 }
@@ -165,19 +188,11 @@ void removeSource(int idx)
     nSources--;
 }
 
-/** Compute cartesian distance between two points */
-float distance(float x1, float y1, float x2, float y2)
-{
-    float dx = x2 - x1;
-    float dy = y2 - y1;
-    return sqrt(dx * dx + dy * dy);
-}
-
 /**
   * @description: Adds a light source to the list of light sources. The light source will have a particular colour
   * and intensity and will move at a particular speed.
 */
-void addSource(int paletteIndex, float intensity)
+void addSource(int paletteIndex, uint8_t intensity)
 {
 
     float x;
@@ -194,18 +209,13 @@ void addSource(int paletteIndex, float intensity)
     //PRINTLOG(n1);
     //int n2;
     //while(1) {
-        n1 = drand48() * layoutData->nPanels;
-        x = layoutData->panels[n1].shape->getCentroid().x;
-        y = layoutData->panels[n1].shape->getCentroid().y;
+        n1 = drand48() * panelOrder.nPanels;
+        x = panelOrder.x[n1];
+        y = panelOrder.y[n1];
 
 
     // decide in the colour of this light source and factor in the intensity to arrive at an RGB value
-    int R = palettenColors[paletteIndex].R;
-    int G = palettenColors[paletteIndex].G;
-    int B = palettenColors[paletteIndex].B;
-    R *= intensity;
-    G *= intensity;
-    B *= intensity;
+    const lut_colour_t &colour = paletteLut.band(paletteIndex, intensity);
 
     // if we have a lot of light sources already, let's bump off the oldest one
     if(nSources >= MAX_SOURCES) {
@@ -214,88 +224,207 @@ void addSource(int paletteIndex, float intensity)
     // add all the information to the list of light sources
     sources[nSources].x = x;
     sources[nSources].y = y;
-    sources[nSources].R = (int)R;
-    sources[nSources].G = (int)G;
-    sources[nSources].B = (int)B;
+    sources[nSources].R = colour.R;
+    sources[nSources].G = colour.G;
+    sources[nSources].B = colour.B;
     sources[nSources].age = 0;
+    sources[nSources].panel = n1;
     //sources[nSources].alive = true;
     nSources++;
   }
 }
 
+/** How sharply a source's light falls off, worked out once per frame */
+float falloffMultiplier()
+{
+    if(TEMPO_ENABLED) {
+        float tempo = getTempo() + 1;
+        return log(tempo+1) + MININMUM_MULTIPLIER;
+    }
+    return MININMUM_MULTIPLIER;
+}
+
+/** Values every panel needs when mixing in the light sources, the uniforms of the kernels below */
+template<class Falloff>
+struct light_uniforms_t {
+    float multiplier;
+    const source_t* sources;
+    int nSources;
+    Falloff falloff;
+};
+
 /**
-  * @description: This function will render the colour of the given single panel given
-  * the positions of all the lights in the light source list.
+  * @description: What the light source kernels below have in common: panels start from the background
+  * colour and the uniforms are the source list. See PanelShader.h for the kernel interface. The falloff
+  * curve is a template parameter, see FalloffCurves.h.
   */
-void renderPanel(Panel *panel, int *returnR, int *returnG, int *returnB)
-{
-    float R = BASE_COLOUR_R;
-    float G = BASE_COLOUR_G;
-    float B = BASE_COLOUR_B;
-    int i;
-    float tempo = getTempo() + 1;
-    // Iterate through all the sources
-    // Depending how close the source is to the panel, we take some fraction of its colour and mix it into an
-    // accumulator. Newest sources have the most weight. Old sources die away until they are gone.
-    for(i = 0; i < nSources; i++) {
-        float d = distance(panel->shape->getCentroid().x, panel->shape->getCentroid().y, sources[i].x, sources[i].y);
-        d = d / ADJACENT_PANEL_DISTANCE;
-        float d2 = d*d;
-        float multiplier = 0;
-        if(TEMPO_ENABLED) {
-          multiplier = log(tempo+1) + MININMUM_MULTIPLIER;
-        } else {
-          multiplier = MININMUM_MULTIPLIER;
+template<class Falloff>
+struct LightKernel {
+    typedef light_uniforms_t<Falloff> uniforms_t;
+
+    void uniforms(uniforms_t* u) const {
+        u->multiplier = falloffMultiplier();
+        u->sources = sources;
+        u->nSources = nSources;
+        u->falloff.setup(1.0 / (ADJACENT_PANEL_DISTANCE * ADJACENT_PANEL_DISTANCE), u->multiplier);
+    }
+
+    int items(const uniforms_t& u) const {
+        return u.nSources;
+    }
+
+    void base(const uniforms_t& u, int panel, float x, float y, float* R, float* G, float* B) const {
+        *R = BASE_COLOUR_R;
+        *G = BASE_COLOUR_G;
+        *B = BASE_COLOUR_B;
+    }
+
+    bool culled(const uniforms_t& u, int item, float minX, float minY, float maxX, float maxY) const {
+        return false;
+    }
+};
+
+/**
+  * @description: Mixes every light source into every panel.
+  * Depending how close the source is to the panel, we take some fraction of its colour and mix it into an
+  * accumulator. Newest sources have the most weight. Old sources die away until they are gone.
+  */
+template<class Falloff>
+struct DistanceKernel : LightKernel<Falloff> {
+    typedef typename LightKernel<Falloff>::uniforms_t uniforms_t;
+
+    void mix(const uniforms_t& u, int item, int panel, float x, float y, float* R, float* G, float* B) const {
+        const source_t& source = u.sources[item];
+        float dx = source.x - x;
+        float dy = source.y - y;
+        float factor = u.falloff.at(dx * dx + dy * dy);// determines how much of the source's colour we mix in (depends on distance)
+                                                        // the formula is not based on physics, it is fudged to get a good effect
+                                                        // the formula yields a number between 0 and 1
+        *R = *R * (1.0f - factor) + source.R * factor;
+        *G = *G * (1.0f - factor) + source.G * factor;
+        *B = *B * (1.0f - factor) + source.B * factor;
+    }
+
+    /** sources further from the block than the curve's cutoff add nothing to it */
+    bool culled(const uniforms_t& u, int item, float minX, float minY, float maxX, float maxY) const {
+        const source_t& source = u.sources[item];
+        float dx = source.x < minX ? minX - source.x : source.x > maxX ? source.x - maxX : 0;
+        float dy = source.y < minY ? minY - source.y : source.y > maxY ? source.y - maxY : 0;
+        return dx * dx + dy * dy > u.falloff.cutoff2();
+    }
+};
+
+/** The light uniforms plus the geodesic distance tables of this frame */
+template<class Falloff>
+struct geodesic_uniforms_t : light_uniforms_t<Falloff> {
+    float hopFactor[GEODESIC_UNREACHABLE + 1]; // the mixing factor for each hop distance
+    std::vector<const uint8_t*> sourceHops; // hop distances from each source's panel
+};
+
+/**
+  * @description: Shape aware version of DistanceKernel: the distance is the number of panels between the
+  * source and this panel, so light does not jump across gaps in the layout. The factor is looked up per hop count.
+  */
+template<class Falloff>
+struct GeodesicKernel : LightKernel<Falloff> {
+    typedef geodesic_uniforms_t<Falloff> uniforms_t;
+
+    void uniforms(uniforms_t* u) const {
+        LightKernel<Falloff>::uniforms(u);
+        for(int i = 0; i < GEODESIC_UNREACHABLE; i++) {
+            u->hopFactor[i] = u->falloff.atPitches(i * i);
+        }
+        u->hopFactor[GEODESIC_UNREACHABLE] = 0; // not connected to the source at all
+        panelGraph.beginFrame();
+        u->sourceHops.resize(u->nSources);
+        for(int i = 0; i < u->nSources; i++) {
+            u->sourceHops[i] = panelGraph.row(u->sources[i].panel);
         }
-        float factor = 1.0 / (d2 * multiplier + 1.0);// determines how much of the source's colour we mix in (depends on distance)
-                                                  // the formula is not based on physics, it is fudged to get a good effect
-                                                  // the formula yields a number between 0 and 1
-        //if(multiplier < MININMUM_MULTIPLIER) {
-        //  factor = 1.0 / (d2*MININMUM_MULTIPLIER + 1.0); // Tempo is finicky, this is to make sure when Tempo = 0 the entire panel doesn't spaz
-        //}
-
-        R = R * (1.0 - factor) + sources[i].R * factor;
-        G = G * (1.0 - factor) + sources[i].G * factor;
-        B = B * (1.0 - factor) + sources[i].B * factor;
     }
-    *returnR = (int)R;
-    *returnG = (int)G;
-    *returnB = (int)B;
-}
+
+    void mix(const uniforms_t& u, int item, int panel, float x, float y, float* R, float* G, float* B) const {
+        const source_t& source = u.sources[item];
+        float factor = u.hopFactor[u.sourceHops[item][panel]];
+        *R = *R * (1.0f - factor) + source.R * factor;
+        *G = *G * (1.0f - factor) + source.G * factor;
+        *B = *B * (1.0f - factor) + source.B * factor;
+    }
+};
+
+/** The light uniforms plus the tree built over this frame's sources */
+struct tree_uniforms_t : light_uniforms_t<InverseSquareFalloff> {
+    const SourceQuadTree* tree;
+};
 
 /**
-  * A simple algorithm to detect beats. It finds a strong signal after a period of quietness.
-  * Actually, it doesn't detect just beats. For example, classical music often doesn't have
-  * strong beats but it has strong instrumental sections. Those would also get detected.
+  * @description: With lots of sources far away clusters are mixed in as a single pseudo-source, see
+  * SourceQuadTree.h. The tree is walked per panel, so everything happens in base(). The tree only knows
+  * the inverse square falloff.
   */
-int16_t beat_detector(int i)
-{
-    int16_t beat_detected = 0;
+struct SourceTreeKernel : LightKernel<InverseSquareFalloff> {
+    typedef tree_uniforms_t uniforms_t;
 
-    //Check for local maximum and if observed, add to running average
-    if((freqBins[i].soundPower + (freqBins[i].runningMax / 4) < freqBins[i].previousPower) && (freqBins[i].previousPower > freqBins[i].secondPreviousPower)){
-        freqBins[i].runningMax = addToRunningMax(freqBins[i].runningMax, freqBins[i].previousPower, 4);
+    void uniforms(uniforms_t* u) const {
+        LightKernel<InverseSquareFalloff>::uniforms(u);
+        sourceTree.build(u->sources, u->nSources);
+        u->tree = &sourceTree;
     }
 
-    // update latest minimum.
-    if(freqBins[i].soundPower < freqBins[i].latest_minimum) {
-        freqBins[i].latest_minimum = freqBins[i].soundPower;
+    int items(const uniforms_t& u) const {
+        return 0;
     }
-    else if(freqBins[i].latest_minimum > 0) {
-        freqBins[i].latest_minimum--;
+
+    void base(const uniforms_t& u, int panel, float x, float y, float* R, float* G, float* B) const {
+        LightKernel<InverseSquareFalloff>::base(u, panel, x, y, R, G, B);
+        u.tree->render(x, y, u.falloff.invPitch2, u.multiplier, BARNES_HUT_THETA, R, G, B);
     }
 
-    // criteria for a "beat"; value must exceed minimum plus a threshold of the runningMax.
-    if(freqBins[i].soundPower > freqBins[i].latest_minimum + (freqBins[i].runningMax * TRIGGER_THRESHOLD)) {
-        freqBins[i].latest_minimum = freqBins[i].soundPower;
-        beat_detected = 1;
+    void mix(const uniforms_t& u, int item, int panel, float x, float y, float* R, float* G, float* B) const {
     }
+};
 
-    // update historical information
-    freqBins[i].secondPreviousPower = freqBins[i].previousPower;
-    freqBins[i].previousPower = freqBins[i].soundPower;
+/**
+  * @description: BARNES_HUT_CHECK: at theta 0 the tree approximates nothing, so every panel has to come out
+  * exactly as DistanceKernel mixes it with every source, in order and none culled. Logs the largest difference.
+  */
+void checkSourceTree()
+{
+    DistanceKernel<InverseSquareFalloff> direct;
+    DistanceKernel<InverseSquareFalloff>::uniforms_t u;
+    direct.uniforms(&u);
+    sourceTree.build(sources, nSources);
+    float worst = 0;
+    for(int p = 0; p < panelOrder.nPanels; p++) {
+        float x = panelOrder.x[p];
+        float y = panelOrder.y[p];
+        float R, G, B, treeR, treeG, treeB;
+        direct.base(u, p, x, y, &R, &G, &B);
+        for(int i = 0; i < u.nSources; i++) {
+            direct.mix(u, i, p, x, y, &R, &G, &B);
+        }
+        direct.base(u, p, x, y, &treeR, &treeG, &treeB);
+        sourceTree.render(x, y, u.falloff.invPitch2, u.multiplier, 0, &treeR, &treeG, &treeB);
+        worst = fmaxf(worst, fmaxf(fabsf(R - treeR), fmaxf(fabsf(G - treeG), fabsf(B - treeB))));
+    }
+    PRINTLOG("Barnes-Hut check: %d sources, largest difference to DistanceKernel at theta 0: %f\n", nSources, worst);
+}
 
-    return beat_detected;
+/**
+  * @description: Renders all panels with the bloom post-process: every source lights up only its own panel
+  * and the light is then spread over the panel graph. Costs O(edges * BLOOM_PASSES) however many sources there are.
+  */
+void renderBloom()
+{
+    if(panelOrder.nPanels == 0) {
+        return;
+    }
+    bloom.clear();
+    for(int i = 0; i < nSources; i++) {
+        // a source sits on the centroid, at distance 0 the falloff gives a factor of 1
+        bloom.emit(sources[i].panel, sources[i].R, sources[i].G, sources[i].B, 1.0);
+    }
+    bloom.spread(BLOOM_PASSES, BLOOM_SPREAD);
+    frameWriter.fromFloat(bloom.R.data(), bloom.G.data(), bloom.B.data(), BASE_COLOUR_R, BASE_COLOUR_G, BASE_COLOUR_B);
 }
 
 /**
@@ -313,57 +442,66 @@ int16_t beat_detector(int i)
  * @param sleepTime: specify interval after which this function is called again, NULL if sound visualization plugin
  */
 void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime) {
-    int R;
-    int G;
-    int B;
     int i;
     uint8_t * fftBins = getFftBins();
 
 #define SKIP_COUNT 50
-    static int cnt = 0;
-    if (cnt < SKIP_COUNT){
-        cnt++;
+    if (warmupFrames < SKIP_COUNT){
+        warmupFrames++;
         return;
     }
 
-    // Compute the sound power (or volume) in each bin
-    for(i = 0; i < nColors; i++) {
-        //PRINTLOG("freq: %d max: %d power: %d\n", i, freqBins[i].runningMax, fftBins[i]);
-        freqBins[i].soundPower = fftBins[i];
-        uint8_t beat_detected = beat_detector(i);
-
-        if(beat_detected) {
-            if (freqBins[i].soundPower > freqBins[i].maximumTrigger) {
-                freqBins[i].maximumTrigger = freqBins[i].soundPower;
-            }
-
-            float intensity = 1.0;
-
-            //calculate an intensity ranging from minimum to 1, using log scale
-            if (freqBins[i].soundPower > 1 && freqBins[i].runningMax > 1){
-                intensity = ((log((float)freqBins[i].soundPower) / log((float)freqBins[i].runningMax)) * (1.0 - MINIMUM_INTENSITY)) + MINIMUM_INTENSITY;
-            }
+    bool isBeat = getIsBeat();
+    bool isOnset = getIsOnset();
+    if(TRACE_BEATS) {
+        // TRACE isBeat isOnset groundTruth bins..., the ground truth is not known on the device
+        PRINTLOG("TRACE %d %d -1", isBeat, isOnset);
+        for(i = 0; i < nColors; i++) {
+            PRINTLOG(" %d", fftBins[i]);
+        }
+        PRINTLOG("\n");
+    }
 
-            if (intensity > 1.0) {
-                intensity = 1.0;
-            }
+    // push this frame's beats, with the SDK's own flags, into the queue
+    markPhase(PHASE_MARK_DETECT);
+    beatSource.detect(fftBins, isBeat, isOnset, BeatQueue::now(), &beatQueue);
 
-            // add a new light source for each beat detected
-            addSource(i, intensity);
+    // add a new light source for each band that beat
+    markPhase(PHASE_MARK_SPAWN);
+    beat_event_t event;
+    while(beatQueue.poll(&spawnCursor, &event)) {
+        if(event.band != BEAT_BAND_NONE) {
+            addSource(event.band, PaletteLut::intensityIndex(event.intensity));
         }
-
     }
+    markPhase(PHASE_MARK_NONE);
 
 
-    // iterate through all the pals and render each one
-    for(i = 0; i < layoutData->nPanels; i++) {
-        renderPanel(&layoutData->panels[i], &R, &G, &B);
-        frames[i].panelId = layoutData->panels[i].panelId;
-        frames[i].r = R;
-        frames[i].g = G;
-        frames[i].b = B;
-        frames[i].transTime = TRANSITION_TIME;
+    // render every panel, walking them in curve order so neighbouring panels are rendered one after the other
+    uint8_t* R = frameWriter.R.data();
+    uint8_t* G = frameWriter.G.data();
+    uint8_t* B = frameWriter.B.data();
+    bool tablesReady = tableBuilder.ready();
+    if(tablesReady && !tablesAnnounced) {
+        PRINTLOG("Derived tables ready, built in %.1f ms\n", tableBuilder.elapsed());
+        tablesAnnounced = true;
+    }
+    markPhase(PHASE_MARK_RENDER);
+    if(BLOOM_ENABLED && tablesReady) {
+        renderBloom();
+    } else if(nSources >= BARNES_HUT_MIN_SOURCES) {
+        shadePanels(SourceTreeKernel(), panelOrder, R, G, B, PANEL_SHADER_THREADS);
+        if(BARNES_HUT_CHECK) {
+            checkSourceTree();
+        }
+    } else if(GEODESIC_ENABLED && tablesReady) {
+        shadePanels(GeodesicKernel<FALLOFF_CURVE>(), panelOrder, R, G, B, PANEL_SHADER_THREADS);
+    } else {
+        shadePanels(DistanceKernel<FALLOFF_CURVE>(), panelOrder, R, G, B, PANEL_SHADER_THREADS);
     }
+    markPhase(PHASE_MARK_WRITE);
+    *nFrames = frameWriter.write(frames);
+    markPhase(PHASE_MARK_NONE);
     if(nSources > 0){ // just to keep the logs from filling up to much
       PRINTLOG("#sources: %d\n", nSources);
     }
@@ -381,8 +519,7 @@ void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime) {
       //PRINTLOG("Energy Change: %d Energy Multi: %f\n", abs(getEnergy()-lastEnergy), (log(abs(getEnergy() - lastEnergy)+1) + MININMUM_MULTIPLIER));
     }
     //PRINTLOG("ONSET: %d\n", getIsOnset());
-    // this algorithm renders every panel at every frame
-    *nFrames = layoutData->nPanels;
+    // this algorithm renders every panel at every frame, frameWriter decides how many of them are sent
 }
 
 /**
@@ -390,5 +527,24 @@ void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime) {
  * Do all deallocation for memory allocated in initplugin here
  */
 void pluginCleanup() {
-    // do deallocation here, but there is nothing to deallocate
+    // the table builder may still be writing to the tables
+    tableBuilder.wait();
+    delete [] sources;
+    sources = NULL;
+    nSources = 0;
+    // hand back the memory of every table, initPlugin builds them all again
+    panelOrder = PanelOrder();
+    panelGeometry = PanelGeometry();
+    panelGraph = PanelGraph();
+    bloom = PanelBloom();
+    frameWriter = FrameWriter();
+    sourceTree = SourceQuadTree();
+    beatSource = BeatSource();
+    paletteLut = PaletteLut();
+    beatQueue.clear();
+    tablesAnnounced = false;
+    warmupFrames = 0;
+    layoutData = NULL;
+    palettenColors = NULL;
+    nColors = 0;
 }
@@ -0,0 +1,96 @@
+/*
+ * BandHistory.cpp
+ *
+ *  Description:
+ *  Per band ring buffers with windowed statistics, see BandHistory.h.
+ */
+
+#include "BandHistory.h"
+
+BandHistory::BandHistory() {
+    init(0, 0, 1);
+}
+
+void BandHistory::init(int bands, int windowLog2, float alpha) {
+    nBands = bands;
+    window = 1 << windowLog2;
+    mask = window - 1;
+    count = 0;
+    frame = 0;
+    emaAlpha = alpha;
+    values.assign(nBands * window, 0);
+    sums.assign(nBands, 0);
+    sumSquares.assign(nBands, 0);
+    emas.assign(nBands, 0);
+    deque_t empty = {0, 0};
+    maxDeques.assign(nBands, empty);
+    minDeques.assign(nBands, empty);
+    maxFrames.assign(nBands * window, 0);
+    minFrames.assign(nBands * window, 0);
+}
+
+/**
+ * add a frame to a monotonic deque. keepLarger makes it a maximum deque, otherwise a minimum one. A template
+ * so the comparison is fixed at compile time in the inner loop.
+ */
+template<bool keepLarger>
+static inline void pushExtreme(uint32_t* ring, uint32_t* front, uint32_t* back, uint32_t mask,
+                               const uint8_t* bandValues, uint32_t frame, uint8_t value) {
+    // the frame dropping out of the window can only be at the front
+    if(*front != *back && frame - ring[*front & mask] > mask) {
+        (*front)++;
+    }
+    // anything behind that the new value beats can never be the extreme again
+    while(*front != *back) {
+        uint8_t last = bandValues[ring[(*back - 1) & mask] & mask];
+        if(keepLarger ? last > value : last < value) {
+            break;
+        }
+        (*back)--;
+    }
+    ring[*back & mask] = frame;
+    (*back)++;
+}
+
+void BandHistory::push(const uint8_t* bins) {
+    uint32_t slot = frame & mask;
+    bool full = count == window;
+    for(int b = 0; b < nBands; b++) {
+        uint8_t* ring = &values[b * window];
+        uint32_t value = bins[b];
+        if(full) {
+            uint32_t old = ring[slot];
+            sums[b] -= old;
+            sumSquares[b] -= old * old;
+        }
+        sums[b] += value;
+        sumSquares[b] += value * value;
+        emas[b] += emaAlpha * (value - emas[b]);
+        ring[slot] = value;
+        pushExtreme<true>(&maxFrames[b * window], &maxDeques[b].front, &maxDeques[b].back, mask, ring, frame, value);
+        pushExtreme<false>(&minFrames[b * window], &minDeques[b].front, &minDeques[b].back, mask, ring, frame, value);
+    }
+    if(!full) {
+        count++;
+    }
+    frame++;
+}
+
+float BandHistory::variance(int band) const {
+    if(count == 0) {
+        return 0;
+    }
+    float m = mean(band);
+    float v = (float)sumSquares[band] / count - m * m;
+    return v > 0 ? v : 0;
+}
+
+uint8_t BandHistory::max(int band) const {
+    const deque_t& deque = maxDeques[band];
+    return deque.front == deque.back ? 0 : values[band * window + (maxFrames[band * window + (deque.front & mask)] & mask)];
+}
+
+uint8_t BandHistory::min(int band) const {
+    const deque_t& deque = minDeques[band];
+    return deque.front == deque.back ? 0 : values[band * window + (minFrames[band * window + (deque.front & mask)] & mask)];
+}
@@ -0,0 +1,74 @@
+/*
+ * BeatQueue.cpp
+ *
+ *  Description:
+ *  Single writer, many reader ring of beat events, see BeatQueue.h.
+ */
+
+#include "BeatQueue.h"
+#include <time.h>
+
+BeatQueue::BeatQueue() {
+    clear();
+}
+
+void BeatQueue::clear() {
+    for(int i = 0; i < BEAT_QUEUE_CAPACITY; i++) {
+        ring[i].version.store(0, std::memory_order_relaxed);
+    }
+    head.store(0, std::memory_order_release);
+}
+
+uint64_t BeatQueue::now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void BeatQueue::push(const beat_event_t& event) {
+    uint64_t sequence = head.load(std::memory_order_relaxed);
+    slot_t& slot = ring[sequence & (BEAT_QUEUE_CAPACITY - 1)];
+    // odd version while the event is half written, readers that see it retry
+    slot.version.store(2 * sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.event = event;
+    slot.version.store(2 * sequence + 2, std::memory_order_release);
+    head.store(sequence + 1, std::memory_order_release);
+}
+
+beat_cursor_t BeatQueue::subscribe(bool history) const {
+    beat_cursor_t cursor;
+    uint64_t h = head.load(std::memory_order_acquire);
+    cursor.next = h;
+    if(history) {
+        cursor.next = h > BEAT_QUEUE_CAPACITY ? h - BEAT_QUEUE_CAPACITY : 0;
+    }
+    cursor.dropped = 0;
+    return cursor;
+}
+
+bool BeatQueue::poll(beat_cursor_t* cursor, beat_event_t* event) const {
+    while(true) {
+        uint64_t h = head.load(std::memory_order_acquire);
+        if(cursor->next >= h) {
+            return false;
+        }
+        // lapped: skip to the oldest event still in the ring
+        if(h - cursor->next > BEAT_QUEUE_CAPACITY) {
+            cursor->dropped += h - BEAT_QUEUE_CAPACITY - cursor->next;
+            cursor->next = h - BEAT_QUEUE_CAPACITY;
+        }
+        const slot_t& slot = ring[cursor->next & (BEAT_QUEUE_CAPACITY - 1)];
+        uint64_t expected = 2 * cursor->next + 2;
+        if(slot.version.load(std::memory_order_acquire) != expected) {
+            continue;  // being overwritten, the lapped check above moves us on
+        }
+        *event = slot.event;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(slot.version.load(std::memory_order_relaxed) != expected) {
+            continue;  // overwritten while we copied it
+        }
+        cursor->next++;
+        return true;
+    }
+}
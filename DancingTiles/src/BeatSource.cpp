@@ -0,0 +1,141 @@
+/*
+ * BeatSource.cpp
+ *
+ *  Description:
+ *  SDK, local and fused beat detection, see BeatSource.h.
+ *  Beat Detection based on FrequncyStars by Nathan Dyck.
+ */
+
+#include "BeatSource.h"
+#include <math.h>
+#include <string.h>
+
+/**
+  * @description: add a value to a running max.
+  * @param: runningMax is current runningMax, valueToAdd is added to runningMax, effectiveTrail
+  *         defines how many values are effectively tracked. Note this is an approximation.
+  * @return: int returned as new runningMax.
+  */
+static int addToRunningMax(int runningMax, int valueToAdd, int effectiveTrail) {
+    int trail = effectiveTrail;
+    if (valueToAdd > runningMax && effectiveTrail > 1) {
+        trail = trail / 2;
+    }
+    return runningMax - ((float)runningMax / effectiveTrail) + ((float)valueToAdd / trail);
+}
+
+BeatSource::BeatSource() {
+    mode = BEAT_SOURCE_LOCAL;
+    nBands = 0;
+    framesSinceOnset = BEAT_FUSION_WINDOW;
+}
+
+void BeatSource::init(int bands, BeatSourceMode beatMode) {
+    mode = beatMode;
+    nBands = bands;
+    framesSinceOnset = BEAT_FUSION_WINDOW;
+    freqBins.resize(nBands);
+    bandHistory.init(nBands, BAND_HISTORY_LOG2, BAND_HISTORY_EMA);
+    // here we initialize our freqency bin values so that the plugin starts working reasonably well right away
+    for (int i = 0; i < nBands; i++) {
+        memset(&freqBins[i], 0, sizeof(freq_bin));
+        freqBins[i].runningMax = 50;//Default 3
+        freqBins[i].maximumTrigger = 1;//Default 1
+    }
+}
+
+/**
+  * A simple algorithm to detect beats. It finds a strong signal after a period of quietness.
+  * Actually, it doesn't detect just beats. For example, classical music often doesn't have
+  * strong beats but it has strong instrumental sections. Those would also get detected.
+  */
+bool BeatSource::detectBand(int i) {
+    freq_bin& bin = freqBins[i];
+    bool beat_detected = false;
+    uint32_t previousPower = bandHistory.at(i, 1);
+    uint32_t secondPreviousPower = bandHistory.at(i, 2);
+
+    //Check for local maximum and if observed, add to running average
+    if((bin.soundPower + (bin.runningMax / 4) < previousPower) && (previousPower > secondPreviousPower)){
+        bin.runningMax = addToRunningMax(bin.runningMax, previousPower, 4);
+    }
+
+    // update latest minimum.
+    if(bin.soundPower < bin.latest_minimum) {
+        bin.latest_minimum = bin.soundPower;
+    }
+    else if(bin.latest_minimum > 0) {
+        bin.latest_minimum--;
+    }
+
+    // criteria for a "beat"; value must exceed minimum plus a threshold of the runningMax.
+    if(bin.soundPower > bin.latest_minimum + (bin.runningMax * TRIGGER_THRESHOLD)) {
+        bin.latest_minimum = bin.soundPower;
+        beat_detected = true;
+    }
+
+    if(beat_detected && bin.soundPower > bin.maximumTrigger) {
+        bin.maximumTrigger = bin.soundPower;
+    }
+    return beat_detected;
+}
+
+/** an intensity ranging from minimum to 1, using log scale */
+float BeatSource::intensity(int i) const {
+    const freq_bin& bin = freqBins[i];
+    float intensity = 1.0;
+    if (bin.soundPower > 1 && bin.runningMax > 1){
+        intensity = ((log((float)bin.soundPower) / log((float)bin.runningMax)) * (1.0 - MINIMUM_INTENSITY)) + MINIMUM_INTENSITY;
+    }
+    if (intensity > 1.0) {
+        intensity = 1.0;
+    }
+    return intensity;
+}
+
+int BeatSource::detect(const uint8_t* fftBins, bool isBeat, bool isOnset, uint64_t now, BeatQueue* queue) {
+    int pushed = 0;
+
+    if(mode == BEAT_SOURCE_SDK) {
+        // no per band detection at all, the SDK's beat goes to whichever band is loudest
+        if(isBeat && nBands > 0) {
+            int loudest = 0;
+            for(int i = 1; i < nBands; i++) {
+                if(fftBins[i] > fftBins[loudest]) {
+                    loudest = i;
+                }
+            }
+            float intensity = MINIMUM_INTENSITY + fftBins[loudest] / 255.0 * (1.0 - MINIMUM_INTENSITY);
+            beat_event_t event = {now, (int16_t)loudest, fftBins[loudest], intensity, isBeat, isOnset};
+            queue->push(event);
+            pushed++;
+        } else if(isOnset) {
+            beat_event_t event = {now, BEAT_BAND_NONE, 0, 0, isBeat, isOnset};
+            queue->push(event);
+            pushed++;
+        }
+        return pushed;
+    }
+
+    bandHistory.push(fftBins);
+    framesSinceOnset = isOnset ? 0 : framesSinceOnset + 1;
+    bool gateOpen = mode == BEAT_SOURCE_LOCAL || framesSinceOnset < BEAT_FUSION_WINDOW;
+
+    // Compute the sound power (or volume) in each bin. The detector keeps running with the gate shut so
+    // its history stays current.
+    for(int i = 0; i < nBands; i++) {
+        freqBins[i].soundPower = fftBins[i];
+        if(detectBand(i) && gateOpen) {
+            beat_event_t event = {now, (int16_t)i, (uint8_t)freqBins[i].soundPower, intensity(i), isBeat, isOnset};
+            queue->push(event);
+            pushed++;
+        }
+    }
+    // keep the SDK's beats even when no band fired, so readers see every beat the SDK reports
+    if(pushed == 0 && (isBeat || isOnset)) {
+        beat_event_t event = {now, BEAT_BAND_NONE, 0, 0, isBeat, isOnset};
+        queue->push(event);
+        pushed++;
+    }
+    return pushed;
+}
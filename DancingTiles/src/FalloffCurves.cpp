@@ -0,0 +1,20 @@
+/*
+ * FalloffCurves.cpp
+ *
+ *  Description:
+ *  The exp lookup table for GaussianFalloff, see FalloffCurves.h.
+ */
+
+#include "FalloffCurves.h"
+
+float falloffExpLut[FALLOFF_LUT_SIZE + 1];
+
+/** fills the table when the plugin is loaded */
+static struct ExpLutBuilder {
+    ExpLutBuilder() {
+        for(int i = 0; i <= FALLOFF_LUT_SIZE; i++) {
+            falloffExpLut[i] = expf(-(float)i * FALLOFF_LUT_RANGE / FALLOFF_LUT_SIZE);
+        }
+        falloffExpLut[FALLOFF_LUT_SIZE] = 0;  // the end of the range is the cutoff
+    }
+} expLutBuilder;
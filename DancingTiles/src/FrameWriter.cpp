@@ -0,0 +1,176 @@
+/*
+ * FrameWriter.cpp
+ *
+ *  Description:
+ *  Colour planes to Frame_t, see FrameWriter.h.
+ */
+
+#include "FrameWriter.h"
+#include <math.h>
+
+FrameWriter::FrameWriter() {
+    nPanels = 0;
+    adaptive = false;
+    tolerance = 0;
+    maxTransTime = 0;
+    frameTime = 1;
+    refreshFrames = 1;
+    frame = 0;
+}
+
+void FrameWriter::init(const PanelOrder& order, int time) {
+    nPanels = order.nPanels;
+    R.assign(nPanels, 0);
+    G.assign(nPanels, 0);
+    B.assign(nPanels, 0);
+    panelId = order.panelId;
+    transTime.assign(nPanels, time);
+    adaptive = false;
+}
+
+void FrameWriter::enableAdaptive(int maxError, int longestTransTime, float timePerFrame, int refresh) {
+    adaptive = true;
+    tolerance = maxError;
+    maxTransTime = longestTransTime;
+    frameTime = timePerFrame;
+    refreshFrames = refresh;
+    frame = 0;
+    // the panels start out black with nothing in flight, and every panel is sent on the first frame
+    startR.assign(nPanels, 0);
+    startG.assign(nPanels, 0);
+    startB.assign(nPanels, 0);
+    targetR.assign(nPanels, 0);
+    targetG.assign(nPanels, 0);
+    targetB.assign(nPanels, 0);
+    fadeStart.assign(nPanels, -refreshFrames);
+    fadeFrames.assign(nPanels, 1);
+    lastR.assign(nPanels, 0);
+    lastG.assign(nPanels, 0);
+    lastB.assign(nPanels, 0);
+    lastVelocityR.assign(nPanels, 0);
+    lastVelocityG.assign(nPanels, 0);
+    lastVelocityB.assign(nPanels, 0);
+}
+
+/** one plane, a plain loop the compiler vectorizes */
+static void quantize(const float* __restrict__ src, float offset, uint8_t* __restrict__ dst, int n) {
+    for(int i = 0; i < n; i++) {
+        float value = src[i] + offset;
+        value = value > 255.0f ? 255.0f : value;
+        value = value < 0.0f ? 0.0f : value;
+        dst[i] = (uint8_t)value;
+    }
+}
+
+void FrameWriter::fromFloat(const float* srcR, const float* srcG, const float* srcB, float offsetR, float offsetG, float offsetB) {
+    if(nPanels == 0) {
+        return;
+    }
+    quantize(srcR, offsetR, &R[0], nPanels);
+    quantize(srcG, offsetG, &G[0], nPanels);
+    quantize(srcB, offsetB, &B[0], nPanels);
+}
+
+int FrameWriter::write(Frame_t* __restrict__ frames) {
+    if(nPanels == 0) {
+        return 0;
+    }
+    if(adaptive) {
+        return writeAdaptive(frames);
+    }
+    const int* __restrict__ ids = &panelId[0];
+    const int* __restrict__ times = &transTime[0];
+    const uint8_t* __restrict__ r = &R[0];
+    const uint8_t* __restrict__ g = &G[0];
+    const uint8_t* __restrict__ b = &B[0];
+    for(int i = 0; i < nPanels; i++) {
+        frames[i].panelId = ids[i];
+        frames[i].r = r[i];
+        frames[i].g = g[i];
+        frames[i].b = b[i];
+        frames[i].transTime = times[i];
+    }
+    return nPanels;
+}
+
+/** largest difference on any channel */
+static inline float channelError(float r1, float g1, float b1, float r2, float g2, float b2) {
+    return fmaxf(fabsf(r1 - r2), fmaxf(fabsf(g1 - g2), fabsf(b1 - b2)));
+}
+
+/** how long a steady fade at this velocity can be aimed ahead before a channel runs out of 0..255 */
+static inline int clampSteps(float value, float velocity, int steps) {
+    if(velocity > 0) {
+        return fminf(steps, (255 - value) / velocity);
+    }
+    if(velocity < 0) {
+        return fminf(steps, value / -velocity);
+    }
+    return steps;
+}
+
+int FrameWriter::writeAdaptive(Frame_t* frames) {
+    int n = 0;
+    for(int i = 0; i < nPanels; i++) {
+        float r = R[i], g = G[i], b = B[i];
+        float velocityR = r - lastR[i], velocityG = g - lastG[i], velocityB = b - lastB[i];
+        bool steady = channelError(velocityR, velocityG, velocityB, lastVelocityR[i], lastVelocityG[i], lastVelocityB[i]) * 2 <= tolerance;
+        lastR[i] = R[i];
+        lastG[i] = G[i];
+        lastB[i] = B[i];
+        lastVelocityR[i] = velocityR;
+        lastVelocityG[i] = velocityG;
+        lastVelocityB[i] = velocityB;
+
+        // what the controller shows right now
+        float t = fminf(1, (frame - fadeStart[i]) / fadeFrames[i]);
+        float shownR = startR[i] + (targetR[i] - startR[i]) * t;
+        float shownG = startG[i] + (targetG[i] - startG[i]) * t;
+        float shownB = startB[i] + (targetB[i] - startB[i]) * t;
+
+        bool stale = frame - fadeStart[i] >= refreshFrames;
+        bool onTrack = channelError(shownR, shownG, shownB, r, g, b) <= tolerance;
+        // a fade still in flight that ends on a colour that is not moving will get there by itself
+        bool arriving = t < 1 && channelError(targetR[i], targetG[i], targetB[i], r, g, b) <= tolerance &&
+                        channelError(velocityR, velocityG, velocityB, 0, 0, 0) <= tolerance;
+        if(!stale && (onTrack || arriving)) {
+            continue;
+        }
+
+        // a steady fade is aimed as far ahead as it can go, anything else goes straight to its colour
+        int time = transTime[i];
+        float aheadR = r, aheadG = g, aheadB = b;
+        if(steady && maxTransTime > time) {
+            int steps = maxTransTime / frameTime;
+            steps = clampSteps(r, velocityR, steps);
+            steps = clampSteps(g, velocityG, steps);
+            steps = clampSteps(b, velocityB, steps);
+            int longer = steps * frameTime;
+            if(longer > time) {
+                time = longer;
+                float fadeLength = time / frameTime;
+                aheadR = r + velocityR * fadeLength;
+                aheadG = g + velocityG * fadeLength;
+                aheadB = b + velocityB * fadeLength;
+            }
+        }
+
+        startR[i] = shownR;
+        startG[i] = shownG;
+        startB[i] = shownB;
+        targetR[i] = aheadR;
+        targetG[i] = aheadG;
+        targetB[i] = aheadB;
+        fadeStart[i] = frame;
+        fadeFrames[i] = fmaxf(1, time / frameTime);
+
+        frames[n].panelId = panelId[i];
+        frames[n].r = aheadR + 0.5;
+        frames[n].g = aheadG + 0.5;
+        frames[n].b = aheadB + 0.5;
+        frames[n].transTime = time;
+        n++;
+    }
+    frame++;
+    return n;
+}
@@ -0,0 +1,53 @@
+/*
+ * InitScheduler.cpp
+ *
+ *  Description:
+ *  Background initialization, see InitScheduler.h.
+ */
+
+#include "InitScheduler.h"
+#include "Logger.h"
+#include <system_error>
+#include <time.h>
+
+InitScheduler::InitScheduler() : done(true), elapsedMs(0) {
+}
+
+InitScheduler::~InitScheduler() {
+    wait();
+}
+
+void InitScheduler::run(InitScheduler* scheduler, void (*task)()) {
+    timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    task();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    scheduler->elapsedMs = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    // publishes everything the task wrote along with the flag
+    scheduler->done.store(true, std::memory_order_release);
+}
+
+void InitScheduler::start(void (*task)(), bool background) {
+    wait();
+    done.store(false, std::memory_order_relaxed);
+    if(background) {
+        try {
+            worker = std::thread(run, this, task);
+            return;
+        } catch(const std::system_error& error) {
+            // no threads to be had (a build without libpthread), fall through and do it here
+            static bool reported = false;
+            if(!reported) {
+                PRINTLOG("Can't start the init thread (%s), building the tables inline\n", error.what());
+                reported = true;
+            }
+        }
+    }
+    run(this, task);
+}
+
+void InitScheduler::wait() {
+    if(worker.joinable()) {
+        worker.join();
+    }
+}
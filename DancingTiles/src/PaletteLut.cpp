@@ -0,0 +1,62 @@
+/*
+ * PaletteLut.cpp
+ *
+ *  Description:
+ *  Palette lookup tables, see PaletteLut.h.
+ */
+
+#include "PaletteLut.h"
+#include <math.h>
+
+#define PALETTE_GAMMA 2.2
+
+PaletteLut::PaletteLut() {
+    for(int i = 0; i < 256; i++) {
+        toLinear[i] = pow(i / 255.0, PALETTE_GAMMA);
+    }
+}
+
+/** clamp a palette channel into a byte, palettes are not guaranteed to stay in range */
+static int channel(int value) {
+    return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+lut_colour_t PaletteLut::mix(const RGB_t& a, const RGB_t& b, float t, bool perceptual) const {
+    lut_colour_t out;
+    if(perceptual) {
+        float gamma = 1.0 / PALETTE_GAMMA;
+        out.R = 255 * pow(toLinear[channel(a.R)] * (1 - t) + toLinear[channel(b.R)] * t, gamma) + 0.5;
+        out.G = 255 * pow(toLinear[channel(a.G)] * (1 - t) + toLinear[channel(b.G)] * t, gamma) + 0.5;
+        out.B = 255 * pow(toLinear[channel(a.B)] * (1 - t) + toLinear[channel(b.B)] * t, gamma) + 0.5;
+    } else {
+        out.R = channel(a.R) * (1 - t) + channel(b.R) * t + 0.5;
+        out.G = channel(a.G) * (1 - t) + channel(b.G) * t + 0.5;
+        out.B = channel(a.B) * (1 - t) + channel(b.B) * t + 0.5;
+    }
+    return out;
+}
+
+lut_colour_t PaletteLut::mixAlong(const RGB_t* palette, int nColours, float t, bool perceptual) const {
+    float position = t * (nColours - 1);
+    int c = (int)position;
+    int next = c + 1 < nColours ? c + 1 : c;
+    return mix(palette[c], palette[next], position - c, perceptual);
+}
+
+void PaletteLut::build(const RGB_t* palette, int nColours, int nBands, bool perceptual) {
+    lut_colour_t none = {0, 0, 0};
+    bands.assign(nBands * PALETTE_LUT_SIZE, none);
+    if(nColours <= 0) {
+        return;
+    }
+
+    RGB_t black = {0, 0, 0};
+    for(int b = 0; b < nBands; b++) {
+        // the bands are spread evenly along the palette, so with as many bands as colours band b is colour b
+        lut_colour_t c = mixAlong(palette, nColours, nBands > 1 ? (float)b / (nBands - 1) : 0, perceptual);
+        RGB_t colour = {c.R, c.G, c.B};
+        for(int i = 0; i < PALETTE_LUT_SIZE; i++) {
+            bands[b * PALETTE_LUT_SIZE + i] = mix(black, colour, (float)i / (PALETTE_LUT_SIZE - 1), perceptual);
+        }
+    }
+}
@@ -0,0 +1,68 @@
+/*
+ * PanelBloom.cpp
+ *
+ *  Description:
+ *  Glow over the panel adjacency graph, see PanelBloom.h.
+ */
+
+#include "PanelBloom.h"
+#include <algorithm>
+
+PanelBloom::PanelBloom() {
+    graph = NULL;
+    maxDegree = 1;
+}
+
+void PanelBloom::init(const PanelGraph* panelGraph) {
+    graph = panelGraph;
+    R.assign(graph->nPanels, 0);
+    G.assign(graph->nPanels, 0);
+    B.assign(graph->nPanels, 0);
+    nextR.assign(graph->nPanels, 0);
+    nextG.assign(graph->nPanels, 0);
+    nextB.assign(graph->nPanels, 0);
+    maxDegree = 1;
+    for(int i = 0; i < graph->nPanels; i++) {
+        maxDegree = std::max(maxDegree, graph->offsets[i + 1] - graph->offsets[i]);
+    }
+}
+
+void PanelBloom::clear() {
+    std::fill(R.begin(), R.end(), 0);
+    std::fill(G.begin(), G.end(), 0);
+    std::fill(B.begin(), B.end(), 0);
+}
+
+void PanelBloom::emit(int panel, float sR, float sG, float sB, float factor) {
+    R[panel] = R[panel] * (1 - factor) + sR * factor;
+    G[panel] = G[panel] * (1 - factor) + sG * factor;
+    B[panel] = B[panel] * (1 - factor) + sB * factor;
+}
+
+/** one pass over one channel */
+static void spreadChannel(int n, const int* offsets, const int* neighbours, float gain,
+                          const float* in, float* out) {
+    for(int i = 0; i < n; i++) {
+        float sum = 0;
+        for(int k = offsets[i]; k < offsets[i + 1]; k++) {
+            sum += in[neighbours[k]];
+        }
+        out[i] = in[i] + gain * sum;
+    }
+}
+
+void PanelBloom::spread(int passes, float spread) {
+    int n = graph->nPanels;
+    if(n == 0 || graph->neighbours.empty()) {
+        return;
+    }
+    float gain = spread / maxDegree;
+    for(int p = 0; p < passes; p++) {
+        spreadChannel(n, graph->offsets.data(), graph->neighbours.data(), gain, R.data(), nextR.data());
+        spreadChannel(n, graph->offsets.data(), graph->neighbours.data(), gain, G.data(), nextG.data());
+        spreadChannel(n, graph->offsets.data(), graph->neighbours.data(), gain, B.data(), nextB.data());
+        R.swap(nextR);
+        G.swap(nextG);
+        B.swap(nextB);
+    }
+}
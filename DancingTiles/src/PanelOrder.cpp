@@ -0,0 +1,76 @@
+/*
+ * PanelOrder.cpp
+ *
+ *  Description:
+ *  Hilbert curve ordering of the layout, see PanelOrder.h.
+ */
+
+#include "PanelOrder.h"
+#include <algorithm>
+
+uint64_t hilbertIndex(uint32_t x, uint32_t y, int order) {
+    uint64_t d = 0;
+    for(uint32_t s = 1u << (order - 1); s > 0; s >>= 1) {
+        uint32_t rx = (x & s) > 0;
+        uint32_t ry = (y & s) > 0;
+        d += (uint64_t)s * s * ((3 * rx) ^ ry);
+        // rotate the quadrant so the curve stays continuous
+        if(ry == 0) {
+            if(rx == 1) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            uint32_t t = x;
+            x = y;
+            y = t;
+        }
+    }
+    return d;
+}
+
+PanelOrder::PanelOrder() {
+    nPanels = 0;
+}
+
+void PanelOrder::build(LayoutData* layoutData) {
+    nPanels = layoutData->nPanels;
+    x.resize(nPanels);
+    y.resize(nPanels);
+    panelId.resize(nPanels);
+    layoutIndex.resize(nPanels);
+    if(nPanels == 0) {
+        return;
+    }
+
+    double minX = layoutData->panels[0].shape->getCentroid().x;
+    double minY = layoutData->panels[0].shape->getCentroid().y;
+    double maxX = minX;
+    double maxY = minY;
+    for(int i = 1; i < nPanels; i++) {
+        const Point &c = layoutData->panels[i].shape->getCentroid();
+        minX = std::min(minX, c.x);
+        maxX = std::max(maxX, c.x);
+        minY = std::min(minY, c.y);
+        maxY = std::max(maxY, c.y);
+    }
+    // same scale on both axes so the curve does not get stretched on long thin walls
+    double extent = std::max(maxX - minX, maxY - minY);
+    double scale = extent > 0 ? ((1u << HILBERT_ORDER) - 1) / extent : 0;
+
+    std::vector<std::pair<uint64_t, int> > keys(nPanels);
+    for(int i = 0; i < nPanels; i++) {
+        const Point &c = layoutData->panels[i].shape->getCentroid();
+        uint32_t gx = (uint32_t)((c.x - minX) * scale);
+        uint32_t gy = (uint32_t)((c.y - minY) * scale);
+        keys[i] = std::make_pair(hilbertIndex(gx, gy, HILBERT_ORDER), i);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    for(int k = 0; k < nPanels; k++) {
+        int i = keys[k].second;
+        layoutIndex[k] = i;
+        panelId[k] = layoutData->panels[i].panelId;
+        x[k] = layoutData->panels[i].shape->getCentroid().x;
+        y[k] = layoutData->panels[i].shape->getCentroid().y;
+    }
+}
@@ -0,0 +1,151 @@
+/*
+ * SourceQuadTree.cpp
+ *
+ *  Description:
+ *  Barnes-Hut style quadtree over the light sources, see SourceQuadTree.h.
+ */
+
+#include "SourceQuadTree.h"
+#include <algorithm>
+#include <math.h>
+
+SourceQuadTree::SourceQuadTree() {
+    sources = NULL;
+}
+
+void SourceQuadTree::build(const source_t* sourceList, int nSources) {
+    sources = sourceList;
+    nodes.clear();
+    index.resize(nSources);
+    for(int i = 0; i < nSources; i++) {
+        index[i] = i;
+    }
+    if(nSources > 0) {
+        buildNode(0, nSources, 0);
+    }
+}
+
+int SourceQuadTree::buildNode(int begin, int end, int depth) {
+    quad_node_t node;
+    node.minX = node.maxX = sources[index[begin]].x;
+    node.minY = node.maxY = sources[index[begin]].y;
+    float x = 0, y = 0, R = 0, G = 0, B = 0, age = 0;
+    for(int i = begin; i < end; i++) {
+        const source_t &s = sources[index[i]];
+        age += index[i];
+        node.minX = std::min(node.minX, s.x);
+        node.maxX = std::max(node.maxX, s.x);
+        node.minY = std::min(node.minY, s.y);
+        node.maxY = std::max(node.maxY, s.y);
+        x += s.x;
+        y += s.y;
+        R += s.R;
+        G += s.G;
+        B += s.B;
+    }
+    node.count = end - begin;
+    node.x = x / node.count;
+    node.y = y / node.count;
+    node.R = R / node.count;
+    node.G = G / node.count;
+    node.B = B / node.count;
+    node.age = age / node.count;
+    node.begin = begin;
+    node.end = end;
+    node.child[0] = node.child[1] = node.child[2] = node.child[3] = -1;
+
+    int id = nodes.size();
+    nodes.push_back(node);
+
+    bool pointLike = node.minX == node.maxX && node.minY == node.maxY;
+    if(node.count <= QUADTREE_LEAF_SIZE || depth >= QUADTREE_MAX_DEPTH || pointLike) {
+        return id;
+    }
+
+    // split into quadrants around the centre of the bounding box
+    float midX = (node.minX + node.maxX) * 0.5f;
+    float midY = (node.minY + node.maxY) * 0.5f;
+    const source_t* s = sources;
+    int* first = &index[0];
+    int* splitX = std::stable_partition(first + begin, first + end, [s, midX](int i) { return s[i].x < midX; });
+    int* splitLow = std::stable_partition(first + begin, splitX, [s, midY](int i) { return s[i].y < midY; });
+    int* splitHigh = std::stable_partition(splitX, first + end, [s, midY](int i) { return s[i].y < midY; });
+    int bounds[5] = {begin, (int)(splitLow - first), (int)(splitX - first), (int)(splitHigh - first), end};
+
+    for(int q = 0; q < 4; q++) {
+        if(bounds[q] < bounds[q + 1]) {
+            int child = buildNode(bounds[q], bounds[q + 1], depth + 1);
+            nodes[id].child[q] = child;
+        }
+    }
+    return id;
+}
+
+void SourceQuadTree::mix(float d2, float R, float G, float B, int count, float invPitch2, float multiplier,
+                         float* accR, float* accG, float* accB) const {
+    // the same sums as InverseSquareFalloff and DistanceKernel, so theta 0 gives the same bits
+    float factor = 1.0f / (d2 * invPitch2 * multiplier + 1.0f);
+    if(count > 1) {
+        // mixing the same colour in count times leaves (1 - factor)^count of the accumulator behind
+        factor = 1.0f - powf(1.0f - factor, count);
+    }
+    *accR = *accR * (1.0f - factor) + R * factor;
+    *accG = *accG * (1.0f - factor) + G * factor;
+    *accB = *accB * (1.0f - factor) + B * factor;
+}
+
+static bool olderFirst(const quad_contribution_t& a, const quad_contribution_t& b) {
+    return a.age < b.age;
+}
+
+void SourceQuadTree::render(float px, float py, float invPitch2, float multiplier, float theta,
+                            float* R, float* G, float* B) const {
+    if(nodes.empty()) {
+        return;
+    }
+    // one list per thread, panels may be rendered on several
+    static thread_local std::vector<quad_contribution_t> seen;
+    seen.clear();
+    int stack[4 * QUADTREE_MAX_DEPTH + 4];
+    int top = 0;
+    stack[top++] = 0;
+    float theta2 = theta * theta;
+
+    while(top > 0) {
+        const quad_node_t &node = nodes[stack[--top]];
+        float dx = node.x - px;
+        float dy = node.y - py;
+        float d2 = dx * dx + dy * dy;
+        float size = std::max(node.maxX - node.minX, node.maxY - node.minY);
+
+        // far enough away (or all sources on one spot): the whole node acts as one pseudo-source
+        if(theta2 > 0 && (size * size < theta2 * d2 || size == 0)) {
+            quad_contribution_t c = {node.age, d2, node.R, node.G, node.B, node.count};
+            seen.push_back(c);
+            continue;
+        }
+
+        bool leaf = true;
+        for(int q = 0; q < 4; q++) {
+            if(node.child[q] >= 0) {
+                stack[top++] = node.child[q];
+                leaf = false;
+            }
+        }
+        if(leaf) {
+            for(int i = node.begin; i < node.end; i++) {
+                const source_t &s = sources[index[i]];
+                float sx = s.x - px;
+                float sy = s.y - py;
+                quad_contribution_t c = {(float)index[i], sx * sx + sy * sy, (float)s.R, (float)s.G, (float)s.B, 1};
+                seen.push_back(c);
+            }
+        }
+    }
+
+    std::sort(seen.begin(), seen.end(), olderFirst);
+    for(size_t i = 0; i < seen.size(); i++) {
+        const quad_contribution_t &c = seen[i];
+        mix(c.d2, c.R, c.G, c.B, c.count, invPitch2, multiplier, R, G, B);
+    }
+}
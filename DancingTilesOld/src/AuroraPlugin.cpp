@@ -92,6 +92,7 @@ static LayoutData *layoutData; // this is our saved pointer to the panel layout
 static source_t sources[MAX_SOURCES]; // this is our array for sources
 static int nSources = 0;
 static freq_bin freq_bins[MAX_PALETTE_COLOURS]; // this is our array for frequency bin historical information.
+static int warmupFrames = 0; // frames skipped so far, see SKIP_COUNT
 
 /**
   * @description: add a value to a running max.
@@ -322,9 +323,8 @@ void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime) {
     uint8_t * fftBins = getFftBins();
 
 #define SKIP_COUNT 50
-    static int cnt = 0;
-    if (cnt < SKIP_COUNT){
-        cnt++;
+    if (warmupFrames < SKIP_COUNT){
+        warmupFrames++;
         return;
     }
 
@@ -380,5 +380,11 @@ void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime) {
  * Do all deallocation for memory allocated in initplugin here
  */
 void pluginCleanup() {
-    // do deallocation here, but there is nothing to deallocate
+    // nothing was allocated, but the state must not carry over to the next initPlugin
+    nSources = 0;
+    memset(freq_bins, 0, sizeof(freq_bins));
+    warmupFrames = 0;
+    layoutData = NULL;
+    paletteColours = NULL;
+    nColours = 0;
 }
@@ -4,5 +4,5 @@
 
 USER_OBJS :=
 
-LIBS := -lPluginUtilities
+LIBS := -lPluginUtilities -ldl
 
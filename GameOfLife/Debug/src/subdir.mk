@@ -4,13 +4,25 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 CPP_SRCS += \
-../src/AuroraPlugin.cpp 
+../src/AuroraPlugin.cpp \
+../src/LifeGrid.cpp \
+../src/LifeRule.cpp \
+../src/PanelGeometry.cpp \
+../src/PatternLibrary.cpp 
 
 OBJS += \
-./src/AuroraPlugin.o 
+./src/AuroraPlugin.o \
+./src/LifeGrid.o \
+./src/LifeRule.o \
+./src/PanelGeometry.o \
+./src/PatternLibrary.o 
 
 CPP_DEPS += \
-./src/AuroraPlugin.d 
+./src/AuroraPlugin.d \
+./src/LifeGrid.d \
+./src/LifeRule.d \
+./src/PanelGeometry.d \
+./src/PatternLibrary.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -0,0 +1,65 @@
+/*
+ * LifeGrid.h
+ *
+ *  Description:
+ *  The Life grid laid behind the panels, stored as a bitboard: one bit per cell, 64 cells to a word, rows
+ *  of whole words. The grid wraps around at its edges so gliders that run off one side come back on the
+ *  other. A generation is worked out 64 cells at a time by adding up the eight neighbours of every cell
+ *  in bit slices and feeding the counts through the rule's boolean network; the rule's lookup table gives
+ *  the same result one cell at a time.
+ */
+
+#ifndef INC_LIFEGRID_H_
+#define INC_LIFEGRID_H_
+
+#include "LifeRule.h"
+#include <stdint.h>
+#include <vector>
+
+#define LIFE_WORD_BITS 64
+
+class LifeGrid {
+public:
+    LifeGrid();
+
+    /**
+     * @description: set up an empty grid
+     * @param width: the width is rounded up to whole words
+     */
+    void init(int width, int height);
+
+    void clear();
+
+    /** @description: bring a cell to life, coordinates wrap around */
+    void set(int x, int y);
+
+    bool get(int x, int y) const;
+
+    /**
+     * @description: bring the cells of a stamp to life, wrapping around the edges. Costs two word ORs per word
+     * of the stamp however many cells it has.
+     * @param rows: stampHeight rows of wordsPerRow words, bit k of word j is column 64 * j + k
+     * @param x, y: where the stamp's top left corner goes
+     */
+    void stamp(const uint64_t* rows, int wordsPerRow, int stampHeight, int x, int y);
+
+    /** @description: work out the next generation with the rule's boolean network */
+    void step(const LifeRule& rule);
+
+    /** @description: work out the next generation one cell at a time with the rule's lookup table */
+    void stepLut(const LifeRule& rule);
+
+    /** @description: the words of row y in this generation and in the one before it */
+    const uint64_t* row(int y) const { return &cells[y * words]; }
+    const uint64_t* previousRow(int y) const { return &previous[y * words]; }
+
+    int width;
+    int height;
+    int words;              // words per row
+
+private:
+    std::vector<uint64_t> cells;
+    std::vector<uint64_t> previous;
+};
+
+#endif /* INC_LIFEGRID_H_ */
@@ -0,0 +1,89 @@
+/*
+ * LifeRule.h
+ *
+ *  Description:
+ *  Outer totalistic Life rules (Conway's B3/S23, HighLife, Day & Night, ...) compiled at run time from a
+ *  rulestring, so the rule can be swapped while the plugin runs. A compiled rule comes in two forms that
+ *  give the same answers:
+ *
+ *  - a 512 entry lookup table indexed by the 3x3 neighbourhood of a cell, for stepping one cell at a time
+ *  - a small boolean network over bit slices, for stepping 64 cells at a time. The network is a reduced
+ *    decision diagram over the cell's own state and the four bits of its neighbour count, written out as a
+ *    list of multiplexers, so every rule costs about as much as a hard coded Conway.
+ *
+ *  Accepted rulestrings are B/S ("B3/S23", "b36s23"), the older S/B form ("23/3") and the names "Conway",
+ *  "Life", "HighLife" and "Day&Night". Neighbour counts run from 0 to 8 over the Moore neighbourhood.
+ */
+
+#ifndef INC_LIFERULE_H_
+#define INC_LIFERULE_H_
+
+#include <stdint.h>
+
+#define LIFE_LUT_SIZE 512       // one entry per 3x3 neighbourhood, bit 4 is the cell itself
+#define LIFE_MAX_OPS 32         // a decision diagram over 5 inputs never needs more nodes than this
+#define LIFE_REGISTERS (LIFE_REG_FIRST_OP + LIFE_MAX_OPS)
+
+// the fixed registers of the boolean network, the multiplexers write to LIFE_REG_FIRST_OP onwards
+#define LIFE_REG_ZERO 0
+#define LIFE_REG_ONE 1
+#define LIFE_REG_COUNT0 2       // LIFE_REG_COUNT0 + k holds bit k of the neighbour count
+#define LIFE_REG_ALIVE 6
+#define LIFE_REG_FIRST_OP 7
+
+/** one multiplexer of the network: out = sel ? hi : lo, all three are register numbers */
+typedef struct {
+    uint8_t sel;
+    uint8_t lo;
+    uint8_t hi;
+} life_op_t;
+
+class LifeRule {
+public:
+    /** @description: starts out as Conway's B3/S23 */
+    LifeRule();
+
+    /**
+     * @description: parse a rulestring and rebuild the lookup table and the network
+     * @return: false (leaving the rule as it was) if the rulestring can't be parsed
+     */
+    bool compile(const char* rulestring);
+
+    /** @description: next state of a cell given its 3x3 neighbourhood, bit 4 is the cell itself */
+    inline bool next(int neighbourhood) const { return lut[neighbourhood]; }
+
+    /**
+     * @description: run the network over 64 cells at once
+     * @param count: the four bit slices of the neighbour counts, least significant first
+     * @param alive: the cells themselves
+     */
+    inline uint64_t evaluate(const uint64_t* count, uint64_t alive) const {
+        uint64_t reg[LIFE_REGISTERS];
+        reg[LIFE_REG_ZERO] = 0;
+        reg[LIFE_REG_ONE] = ~(uint64_t)0;
+        reg[LIFE_REG_COUNT0] = count[0];
+        reg[LIFE_REG_COUNT0 + 1] = count[1];
+        reg[LIFE_REG_COUNT0 + 2] = count[2];
+        reg[LIFE_REG_COUNT0 + 3] = count[3];
+        reg[LIFE_REG_ALIVE] = alive;
+        for(int k = 0; k < nOps; k++) {
+            const life_op_t& op = ops[k];
+            reg[LIFE_REG_FIRST_OP + k] = (reg[op.lo] & ~reg[op.sel]) | (reg[op.hi] & reg[op.sel]);
+        }
+        return reg[output];
+    }
+
+    uint16_t born;          // bit n set: a dead cell with n live neighbours comes alive
+    uint16_t survive;       // bit n set: a live cell with n live neighbours stays alive
+    char name[32];          // the rule in B/S form
+
+private:
+    int buildNode(uint32_t table, int level);
+
+    uint8_t lut[LIFE_LUT_SIZE];
+    life_op_t ops[LIFE_MAX_OPS];
+    int nOps;
+    int output;             // register holding the next state
+};
+
+#endif /* INC_LIFERULE_H_ */
@@ -0,0 +1,107 @@
+/*
+ * PatternLibrary.h
+ *
+ *  Description:
+ *  The Life patterns beats can spawn: a few built in ones plus every .rle file in a corpus directory
+ *  (spaceships, puffers, oscillators, guns, ...). Each pattern is parsed once, with a streaming RLE parser,
+ *  and compiled into bitmask stamps for each of its distinct orientations (up to 8: four rotations, each
+ *  mirrored or not). The stamps are rows of 64 bit words laid out like the rows of a LifeGrid, so dropping a
+ *  pattern into the grid is a handful of word ORs with no parsing or allocation.
+ *
+ *  The compiled library is kept in a flat cache file that is mapped straight into memory:
+ *
+ *      stamp_cache_header_t
+ *      stamp_pattern_t[nPatterns]
+ *      stamp_t[nStamps]
+ *      uint64_t[nWords]            the rows of every stamp, back to back
+ *
+ *  The header carries a hash of the corpus it was built from: the name, size and modification time of every
+ *  .rle file. The cache is rebuilt whenever that doesn't match the directory any more (a file added, removed
+ *  or changed, whatever its time stamp) or it is missing or from another version. If it can't be written
+ *  the library is kept in memory in the same layout.
+ */
+
+#ifndef INC_PATTERNLIBRARY_H_
+#define INC_PATTERNLIBRARY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define STAMP_CACHE_MAGIC "LIFESTMP"
+#define STAMP_CACHE_VERSION 2
+#define STAMP_MAX_SIDE 256          // patterns bigger than this either way are left out
+#define STAMP_NAME_LENGTH 48
+#define STAMP_ORIENTATIONS 8
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t nPatterns;
+    uint32_t nStamps;
+    uint32_t nWords;
+    uint32_t nCorpusFiles;      // .rle files the cache was built from
+    uint32_t reserved;
+    uint64_t corpusHash;        // of their names, sizes and modification times
+} stamp_cache_header_t;
+
+typedef struct {
+    char name[STAMP_NAME_LENGTH];
+    uint16_t width;
+    uint16_t height;
+    uint32_t cells;             // live cells
+    uint32_t firstStamp;        // its stamps are stamps[firstStamp] .. stamps[firstStamp + nStamps - 1]
+    uint32_t nStamps;           // distinct orientations, 1 to 8
+} stamp_pattern_t;
+
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+    uint16_t wordsPerRow;
+    uint16_t reserved;
+    uint32_t firstWord;         // row r is words[firstWord + r * wordsPerRow] ..
+    uint32_t cells;
+} stamp_t;
+
+class PatternLibrary {
+public:
+    PatternLibrary();
+    ~PatternLibrary();
+
+    /**
+     * @description: load the library from the cache, compiling the built in patterns and the corpus into
+     * it first if it's out of date
+     * @param corpusDir: directory of .rle files, may be missing
+     * @param cachePath: the cache file, NULL to keep the library in memory only
+     * @return: the number of patterns
+     */
+    int load(const char* corpusDir, const char* cachePath);
+
+    /** @description: unmap or free the library */
+    void unload();
+
+    int nPatterns() const { return header ? header->nPatterns : 0; }
+    const stamp_pattern_t& pattern(int i) const { return patterns[i]; }
+
+    /** @description: the stamp of a pattern in one of its orientations, any orientation number works */
+    const stamp_t& stamp(int pattern, int orientation) const {
+        return stamps[patterns[pattern].firstStamp + orientation % patterns[pattern].nStamps];
+    }
+
+    /** @description: the first word of a stamp's rows */
+    const uint64_t* stampWords(const stamp_t& s) const { return words + s.firstWord; }
+
+private:
+    bool mapCache(const char* cachePath, uint32_t nCorpusFiles, uint64_t corpusHash);
+    bool attach(const uint8_t* data, size_t size);
+
+    const stamp_cache_header_t* header;
+    const stamp_pattern_t* patterns;
+    const stamp_t* stamps;
+    const uint64_t* words;
+    void* mapped;               // the mapped cache, NULL when the library lives in memoryImage
+    size_t mappedSize;
+    std::vector<uint64_t> memoryImage;
+};
+
+#endif /* INC_PATTERNLIBRARY_H_ */
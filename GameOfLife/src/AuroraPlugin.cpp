@@ -20,9 +20,12 @@
 
     Description:
     Beat Detection, FFT to light source color and Panel Color calculations based on FrequncyStars by Nathan Dyck.
-    Each light source on the grid follows the rules to Conway's Game of Life.
-    Whenever a beat is detected a new "glider" is randomly spawned at the center of one of the panels.
-    each loop calculates the next generation of live cells and removes the dead cells from the grid.
+    A Game of Life grid is laid behind the panels and every live cell carries a colour.
+    Whenever a beat is detected a pattern (a glider, a spaceship, an oscillator, ... see PatternLibrary) is spawned
+    at the center of a random panel.
+    each loop calculates the next generation of the grid and lights every panel with the live cells under it.
+    The rule is compiled from a rulestring at run time and moves on to the next one in LIFE_RULES whenever the
+    music stops for a while, so every song gets its own kind of life.
  */
 
 
@@ -36,7 +39,13 @@
 #include <string.h>
 #include "Logger.h"
 #include "PluginFeatures.h"
+#include "LifeGrid.h"
+#include "LifeRule.h"
+#include "PanelGeometry.h"
+#include "PatternLibrary.h"
 #include <stdlib.h>
+#include <dlfcn.h>
+#include <string>
 #include <vector>
 #include <algorithm>
 
@@ -53,7 +62,6 @@ extern "C" {
 #endif
 
 #define MAX_PALETTE_COLOURS 7   // if more colours then this, we will use just the first this many
-#define MAX_CELLS 50   // maxiumum number of cells, might increase this considering a glider takes 5 cells
 #define BASE_COLOUR_R 0 // these three settings defined the background colour; set to black
 #define BASE_COLOUR_G 0
 #define BASE_COLOUR_B 0
@@ -61,20 +69,15 @@ extern "C" {
 #define TRANSITION_TIME 2  // the transition time to send to panels; set to 100ms currently
 #define MINIMUM_INTENSITY 0.2  // the minimum intensity of a source
 #define TRIGGER_THRESHOLD 0.7 // used to calculate whether to add a source
-
-// Here we store the information accociated with each light source like current
-// position, velocity and colour. The information is stored in a list called cells.
-struct cell_t {
-    float x;
-    float y;
-    int R;
-    int G;
-    int B;
-    bool operator==(const cell_t &b) {
-      return x == b.x && y == b.y;
-    }
-
-};
+//Life consts
+#define LIFE_RULES {"B3/S23", "B36/S23", "B3678/S34678"} //rules to cycle through, one per song; any B/S rulestring works
+#define LIFE_CELLS_PER_PANEL 6 //grid cells across the distance between two adjacent panels
+#define LIFE_BITBOARD true //step 64 cells at a time with the rule's boolean network, false steps cell by cell with its lookup table
+#define LIFE_FULL_DENSITY 0.25 //fraction of live cells under a panel that lights it up fully
+#define SILENCE_LEVEL 2 //fft bins below this count as silence
+#define SONG_BREAK_FRAMES 40 //frames of silence taken as the end of a song, after which the next rule is used
+#define PATTERN_CORPUS_DIR "patterns" //directory of .rle files beats spawn patterns from, on top of the built in ones; next to the plugin's .so
+#define PATTERN_CACHE_FILE "stamps.cache" //the compiled patterns, kept in PATTERN_CORPUS_DIR and rebuilt when the .rle files change
 
 /** Here we store the information accociated with each frequency bin. This
  allows for tracking a degree of historical information.
@@ -93,24 +96,22 @@ typedef struct {
 static RGB_t* paletteColours = NULL; // this is our saved pointer to the colour palette
 static int nColours = 0;             // the number of colours in the palette
 static LayoutData *layoutData; // this is our saved pointer to the panel layout information
-static cell_t cells[MAX_CELLS]; // this is our array for cells
-static int ncells = 0;
+static const char* lifeRules[] = LIFE_RULES;
+static int ruleIndex = 0; // the rule in lifeRules in use
+static LifeRule rule; // the compiled rule
+static LifeGrid grid; // the live cells
+static std::vector<RGB_t> cellColours; // the colour of every cell, only meaningful for live ones
+static std::vector<int> cellPanel; // the panel each grid cell lies in, -1 for cells between or around the panels
+static std::vector<int> panelCells; // number of grid cells in each panel
+static std::vector<RGB_t> panelSum; // colours of the live cells under each panel, added up
+static std::vector<int> panelLive; // number of live cells under each panel
+static float originX, originY; // layout coordinates of the grid's corner
+static float cellSize; // size of one grid cell in layout coordinates
+static int silentFrames = 0;
+static PatternLibrary patternLibrary; // everything a beat can spawn
+static std::vector<int> spawnPatterns; // the patterns in patternLibrary that fit in the grid
 static freq_bin freq_bins[MAX_PALETTE_COLOURS]; // this is our array for frequency bin historical information.
-/**
-//arrays represting the different types of game of life items to spawn, 0 for no item, 1 for spawn item
-//Spaceships
-static int[3][3] glider = [[1,0,0],[0,0,1],[1,1,1]];
-static int[4][5] lwss = [[1, 0, 0, 1, 0], [0, 0, 0, 0, 1], [1, 0, 0, 0, 1], [0, 1, 1, 1, 1]] //Lightweight Spaceship
-
-//Oscillators
-static int[3][3] blinker = [[0,1,0],[0,1,0],[0,1,0]];
-static int[2][4] toad = [[0, 1, 1, 1], [1, 1, 1, 0]];
-
-//Stil Lifes
-static int[2][2] block = [[1, 1], [1, 1]];
-static int[3][4] beehive = [[0, 1, 1, 0], [1, 0, 0, 1], [0, 1, 1, 0]];
-**/
-
+static int warmupFrames = 0; // frames skipped so far, see SKIP_COUNT
 /**
   * @description: add a value to a running max.
   * @param: runningMax is current runningMax, valueToAdd is added to runningMax, effectiveTrail
@@ -125,6 +126,21 @@ int addToRunningMax(int runningMax, int valueToAdd, int effectiveTrail) {
     return runningMax - ((float)runningMax / effectiveTrail) + ((float)valueToAdd / trail);
 }
 
+/**
+  * @description: the directory the plugin's .so was loaded from. The host's working directory is anyone's
+  * guess, so files that ship with the plugin are looked for (and written) here.
+  * @return: the directory, empty if it can't be told
+  */
+std::string pluginDirectory() {
+    Dl_info info;
+    if(dladdr((void*)&initPlugin, &info) == 0 || info.dli_fname == NULL) {
+        return "";
+    }
+    std::string path = info.dli_fname;
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? "" : path.substr(0, slash);
+}
+
 /**
  * @description: Initialize the plugin. Called once, when the plugin is loaded.
  * This function can be used to load the LayoutData and the colorPalette from the DataManager.
@@ -162,316 +178,199 @@ void initPlugin() {
         freq_bins[i].runningMax = 3;
         freq_bins[i].maximumTrigger = 1;
     }
-    enableFft(nColours);
-}
-
 
-
-/** Removes a light source from the list of light cells */
-void removeSource(int idx)
-{
-    memmove(cells + idx, cells + idx + 1, sizeof(cell_t) * (ncells - idx - 1));
-    //cells.erase(cells.begin() + idx);
-    ncells--;
+    // lay a square grid over the layout, as many words wide as it takes to cover the longer side
+    PanelGeometry geometry;
+    geometry.build(layoutData);
+    geometry_box_t box = geometry.bounds();
+    cellSize = ADJACENT_PANEL_DISTANCE / LIFE_CELLS_PER_PANEL;
+    originX = box.minX;
+    originY = box.minY;
+    int side = std::max(box.maxX - box.minX, box.maxY - box.minY) / cellSize + 1;
+    side = (side + LIFE_WORD_BITS - 1) / LIFE_WORD_BITS * LIFE_WORD_BITS;
+    grid.init(side, side);
+    cellColours.assign(grid.width * grid.height, RGB_t());
+    cellPanel.assign(grid.width * grid.height, -1);
+    panelCells.assign(layoutData->nPanels, 0);
+    panelSum.resize(layoutData->nPanels);
+    panelLive.resize(layoutData->nPanels);
+    geometry.rasterize(originX, originY, cellSize, grid.width, &cellPanel, &panelCells);
+    if(!rule.compile(lifeRules[ruleIndex])) {
+        PRINTLOG("Can't read the rule %s, using %s\n", lifeRules[ruleIndex], rule.name);
+    }
+    PRINTLOG("Life grid %d x %d, rule %s\n", grid.width, grid.height, rule.name);
+
+    std::string pluginDir = pluginDirectory();
+    if(pluginDir.empty()) {
+        PRINTLOG("Can't tell where the plugin is, only the built in patterns are used\n");
+        patternLibrary.load(NULL, NULL);
+    } else {
+        std::string corpusDir = pluginDir + "/" + PATTERN_CORPUS_DIR;
+        patternLibrary.load(corpusDir.c_str(), (corpusDir + "/" + PATTERN_CACHE_FILE).c_str());
+    }
+    spawnPatterns.clear();
+    for(int i = 0; i < patternLibrary.nPatterns(); i++) {
+        const stamp_pattern_t& pattern = patternLibrary.pattern(i);
+        if(std::max(pattern.width, pattern.height) <= grid.height) {
+            spawnPatterns.push_back(i);
+        }
+    }
+    PRINTLOG("%d of %d patterns fit in the grid\n", (int)spawnPatterns.size(), patternLibrary.nPatterns());
+    enableFft(nColours);
 }
 
-/** Compute cartesian distance between two points */
-float distance(float x1, float y1, float x2, float y2)
-{
-    float dx = x2 - x1;
-    float dy = y2 - y1;
-    return sqrt(dx * dx + dy * dy);
+/**
+  * @description: move on to the next rule in LIFE_RULES
+  */
+void nextRule() {
+    int nRules = sizeof(lifeRules) / sizeof(lifeRules[0]);
+    ruleIndex = (ruleIndex + 1) % nRules;
+    if(!rule.compile(lifeRules[ruleIndex])) {
+        PRINTLOG("Can't read the rule %s, keeping %s\n", lifeRules[ruleIndex], rule.name);
+        return;
+    }
+    PRINTLOG("New song, rule %s\n", rule.name);
 }
 
 /**
-  * @description: Adds a light source to the list of light cells. The light source will have a particular colour
-  * and intensity and will move at a particular speed.
+  * @description: Spawns a random pattern, in a random orientation and with the given colour and intensity,
+  * centred on a random panel. The pattern is already compiled into a stamp so this costs the same every time.
 */
 void addSource(int paletteIndex, float intensity)
 {
-    float x;
-    float y;
-
     // we need at least two panels to do anything meaningful in here
-    if(layoutData->nPanels < 2) {
+    if(layoutData->nPanels < 2 || spawnPatterns.empty()) {
         return;
     }
-    // pick a random panel
-    int n1;
-    //PRINTLOG(n1);
-    //int n2;
-    bool toggle = true;
-    while(toggle) {
-      toggle = false;
-      n1 = drand48() * layoutData->nPanels;
-      x = layoutData->panels[n1].shape->getCentroid().x;
-      y = layoutData->panels[n1].shape->getCentroid().y;
-      for(int i = 0; i < ncells; i++) {
-        if(cells[i].x == x && cells[i].y == y);
-      }
-    }
-
+    // pick a random panel, pattern and orientation
+    int n1 = drand48() * layoutData->nPanels;
+    int pattern = spawnPatterns[(int)(drand48() * spawnPatterns.size())];
+    const stamp_t& stamp = patternLibrary.stamp(pattern, drand48() * STAMP_ORIENTATIONS);
+    const uint64_t* rows = patternLibrary.stampWords(stamp);
+    int x = (layoutData->panels[n1].shape->getCentroid().x - originX) / cellSize - stamp.width / 2;
+    int y = (layoutData->panels[n1].shape->getCentroid().y - originY) / cellSize - stamp.height / 2;
+    x = ((x % grid.width) + grid.width) % grid.width;
+    y = ((y % grid.height) + grid.height) % grid.height;
 
     // decide in the colour of this light source and factor in the intensity to arrive at an RGB value
-    int R = paletteColours[paletteIndex].R;
-    int G = paletteColours[paletteIndex].G;
-    int B = paletteColours[paletteIndex].B;
-    R *= intensity;
-    G *= intensity;
-    B *= intensity;
-
-    // if we're going to overflow the matrix then kill off cells to make space
-    // TODO: we should generate a array of items to add and then make space and add the new items
-    if(ncells >= MAX_CELLS-5) {
-      for(int j =0; j < 5; j++) {
-        removeSource(0);
-        ncells--;
-      }
+    RGB_t colour;
+    colour.R = paletteColours[paletteIndex].R * intensity;
+    colour.G = paletteColours[paletteIndex].G * intensity;
+    colour.B = paletteColours[paletteIndex].B * intensity;
+
+    grid.stamp(rows, stamp.wordsPerRow, stamp.height, x, y);
+    for(int r = 0; r < stamp.height; r++) {
+        int cy = (y + r) % grid.height;
+        for(int k = 0; k < stamp.wordsPerRow; k++) {
+            uint64_t bits = rows[r * stamp.wordsPerRow + k];
+            while(bits) {
+                int cx = (x + k * LIFE_WORD_BITS + __builtin_ctzll(bits)) % grid.width;
+                bits &= bits - 1;
+                cellColours[cy * grid.width + cx] = colour;
+            }
+        }
     }
+}
 
-    // add all the information to the list of light cells
-    //Spawns a Conways game of life gliders
-    //TODO: this currently spawns a glider facing one direction, make it so the direction is random
-    //TODO: make it so the type of Game of Life item that is spawned is random, Glider, Blinker, Block, etc.
-
-    cells[ncells].x = x+1;
-    cells[ncells].y = y-1;
-    cells[ncells].R = (int)R;
-    cells[ncells].G = (int)G;
-    cells[ncells].B = (int)B;
-    ncells++;
-
-    cells[ncells].x = x+1;
-    cells[ncells].y = y;
-    cells[ncells].R = (int)R;
-    cells[ncells].G = (int)G;
-    cells[ncells].B = (int)B;
-    ncells++;
-
-    cells[ncells].x = x;
-    cells[ncells].y = y-1;
-    cells[ncells].R = (int)R;
-    cells[ncells].G = (int)G;
-    cells[ncells].B = (int)B;
-    ncells++;
-
-    cells[ncells].x = x-1;
-    cells[ncells].y = y-1;
-    cells[ncells].R = (int)R;
-    cells[ncells].G = (int)G;
-    cells[ncells].B = (int)B;
-    ncells++;
-
-    cells[ncells].x = x;
-    cells[ncells].y = y+1;
-    cells[ncells].R = (int)R;
-    cells[ncells].G = (int)G;
-    cells[ncells].B = (int)B;
-    ncells++;
+/**
+  * @description: colour the cells that were just born with the average colour of the live cells around them.
+  * Cells that stay alive keep their colour.
+  */
+void colourNewCells()
+{
+    for(int y = 0; y < grid.height; y++) {
+        for(int w = 0; w < grid.words; w++) {
+            uint64_t born = grid.row(y)[w] & ~grid.previousRow(y)[w];
+            while(born) {
+                int x = w * LIFE_WORD_BITS + __builtin_ctzll(born);
+                born &= born - 1;
+                RGB_t sum = {0, 0, 0};
+                int n = 0;
+                for(int dy = -1; dy <= 1; dy++) {
+                    int ny = (y + dy + grid.height) % grid.height;
+                    const uint64_t* previous = grid.previousRow(ny);
+                    for(int dx = -1; dx <= 1; dx++) {
+                        int nx = (x + dx + grid.width) % grid.width;
+                        if((previous[nx / LIFE_WORD_BITS] >> (nx % LIFE_WORD_BITS)) & 1) {
+                            const RGB_t& c = cellColours[ny * grid.width + nx];
+                            sum.R += c.R;
+                            sum.G += c.G;
+                            sum.B += c.B;
+                            n++;
+                        }
+                    }
+                }
+                RGB_t& colour = cellColours[y * grid.width + x];
+                colour.R = n > 0 ? sum.R / n : 0;
+                colour.G = n > 0 ? sum.G / n : 0;
+                colour.B = n > 0 ? sum.B / n : 0;
+            }
+        }
+    }
+}
 
+/**
+  * @description: add up the live cells under every panel. Only live cells are visited so the cost follows
+  * the population rather than the size of the grid.
+  */
+void gatherPanels()
+{
+    RGB_t black = {0, 0, 0};
+    std::fill(panelSum.begin(), panelSum.end(), black);
+    std::fill(panelLive.begin(), panelLive.end(), 0);
+    for(int y = 0; y < grid.height; y++) {
+        for(int w = 0; w < grid.words; w++) {
+            uint64_t live = grid.row(y)[w];
+            while(live) {
+                int c = y * grid.width + w * LIFE_WORD_BITS + __builtin_ctzll(live);
+                live &= live - 1;
+                int panel = cellPanel[c];
+                if(panel >= 0) {
+                    panelSum[panel].R += cellColours[c].R;
+                    panelSum[panel].G += cellColours[c].G;
+                    panelSum[panel].B += cellColours[c].B;
+                    panelLive[panel]++;
+                }
+            }
+        }
+    }
 }
 
 /**
-  * @description: This function will render the colour of the given single panel given
-  * the positions of all the lights in the light source list.
+  * @description: This function will render the colour of the given single panel from the live cells under it,
+  * as bright as how crowded the panel is.
   */
-void renderPanel(Panel *panel, int *returnR, int *returnG, int *returnB)
+void renderPanel(int panel, int *returnR, int *returnG, int *returnB)
 {
     float R = BASE_COLOUR_R;
     float G = BASE_COLOUR_G;
     float B = BASE_COLOUR_B;
-    int i;
-
-    // Iterate through all the cells
-    // Depending how close the source is to the panel, we take some fraction of its colour and mix it into an
-    // accumulator. Newest cells have the most weight. Old cells die away until they are gone.
-    for(i = 0; i < ncells; i++) {
-        float d = distance(panel->shape->getCentroid().x, panel->shape->getCentroid().y, cells[i].x, cells[i].y);
-        d = d / ADJACENT_PANEL_DISTANCE;
-        float d2 = d * d;
-        float factor = 1.0 / (d2 * 1.5 + 1.0); // determines how much of the source's colour we mix in (depends on distance)
-                                               // the formula is not based on physics, it is fudged to get a good effect
-                                               // the formula yields a number between 0 and 1
-        R = R * (1.0 - factor) + cells[i].R * factor;
-        G = G * (1.0 - factor) + cells[i].G * factor;
-        B = B * (1.0 - factor) + cells[i].B * factor;
+    int live = panelLive[panel];
+    if(live > 0) {
+        float factor = live / (panelCells[panel] * LIFE_FULL_DENSITY + 1); // how much of the cells' colour we mix in
+        if(factor > 1.0) {
+            factor = 1.0;
+        }
+        R = R * (1.0 - factor) + (float)panelSum[panel].R / live * factor;
+        G = G * (1.0 - factor) + (float)panelSum[panel].G / live * factor;
+        B = B * (1.0 - factor) + (float)panelSum[panel].B / live * factor;
     }
     *returnR = (int)R;
     *returnG = (int)G;
     *returnB = (int)B;
 }
 
-void spawn(int x, int y, int R, int G, int B) {
-  if(ncells >= MAX_CELLS) {
-    removeSource(0);
-  }
-  // add all the information to the list of light cells
-  cells[ncells].x = x;
-  cells[ncells].y = y;
-  cells[ncells].R = (int)R;
-  cells[ncells].G = (int)G;
-  cells[ncells].B = (int)B;
-  ncells++;
-}
-
 /**
-  * Move the positions of all the light cells based on their velocities. If any particular
-  * light source has moved far from the origin then it will be removed from the light source list.
+  * @description: work out the next generation of the grid
   */
 void generateNextGeneration(void)
 {
-  std::vector<cell_t> new_cells;
-  //  PRINTLOG("#0 new_cells: %d\n", new_cells.size());
-
-
-  //Find the overpopulated/underpopulated live cells
-  for(int i = 0; i < ncells; i++) {
-    int numNeighbors = 0;
-    for(int j = 0; j < ncells; j++) {
-      if ((cells[i].x + 1 > cells[j].x &&
-          cells[i].x - 1 < cells[j].x) &&
-          (cells[i].y + 1 > cells[j].y ||
-          cells[i].y - 1 < cells[j].y)) {
-        numNeighbors++;
-      }
+    if(LIFE_BITBOARD) {
+        grid.step(rule);
+    } else {
+        grid.stepLut(rule);
     }
-    numNeighbors--;
-    if(numNeighbors == 2 || numNeighbors == 3) {
-      cell_t new_cell;
-      new_cell.x = cells[i].x;
-      new_cell.y = cells[i].y;
-      new_cell.R = cells[i].R;
-      new_cell.G = cells[i].G;
-      new_cell.B = cells[i].B;
-      new_cells.push_back(new_cell);
-
-    }
-  }
-  //PRINTLOG("#1 new_cells: %d\n", new_cells.size());
-
-  //Find where to spawn new cells
-  for(int i = 0; i < ncells; i++) {
-    int numNeighbors = 0;
-    RGB_t new_rgb;
-    for(int j = 0; j < ncells; j++) {
-      if ((cells[i].x + 1 == cells[j].x ||
-          cells[i].x + 2 == cells[j].x ||
-          cells[i].y + 1 == cells[j].y ||
-          cells[i].y + 2 == cells[j].y) &&
-          (cells[i].x + 1 != cells[j].x ||
-            cells[i].y + 1 != cells[j].y))   {
-            numNeighbors++;
-            new_rgb.R += cells[j].R;
-            new_rgb.G += cells[j].G;
-            new_rgb.B += cells[j].B;
-          }
-    }
-    if(numNeighbors == 3) {
-      cell_t new_cell;
-      new_cell.x = cells[i].x + 1;
-      new_cell.y = cells[i].y + 1;
-      new_cell.R = (int)new_rgb.R/3;
-      new_cell.G = (int)new_rgb.G/3;
-      new_cell.B = (int)new_rgb.B/3;
-      new_cells.push_back(new_cell);
-    }
-  }
-
-  for(int i = 0; i < ncells; i++) {
-    int numNeighbors = 0;
-    RGB_t new_rgb;
-    for(int j = 0; j < ncells; j++) {
-      if ((cells[i].x - 1 == cells[j].x ||
-          cells[i].x - 2 == cells[j].x ||
-          cells[i].y + 1 == cells[j].y ||
-          cells[i].y + 2 == cells[j].y)&&
-          (cells[i].x - 1 != cells[j].x ||
-            cells[i].y + 1 != cells[j].y))   {
-            numNeighbors++;
-            new_rgb.R += cells[j].R;
-            new_rgb.G += cells[j].G;
-            new_rgb.B += cells[j].B;
-          }
-    }
-    if(numNeighbors == 3) {
-      cell_t new_cell;
-      new_cell.x = cells[i].x - 1;
-      new_cell.y = cells[i].y + 1;
-      new_cell.R = cells[i].R; //(int)new_rgb.R/3;
-      new_cell.G = cells[i].G; //(int)new_rgb.G/3;
-      new_cell.B = cells[i].B; //(int)new_rgb.B/3;
-      new_cells.push_back(new_cell);
-    }
-  }
-  for(int i = 0; i < ncells; i++) {
-    int numNeighbors = 0;
-    RGB_t new_rgb;
-    for(int j = 0; j < ncells; j++) {
-      if ((cells[i].x - 1 == cells[j].x ||
-          cells[i].x - 2 == cells[j].x ||
-          cells[i].y - 1 == cells[j].y ||
-          cells[i].y - 2 == cells[j].y)&&
-          (cells[i].x - 1 != cells[j].x ||
-            cells[i].y - 1 != cells[j].y))   {
-            numNeighbors++;
-            new_rgb.R += cells[j].R;
-            new_rgb.G += cells[j].G;
-            new_rgb.B += cells[j].B;
-          }
-    }
-    if(numNeighbors == 3) {
-      cell_t new_cell;
-      new_cell.x = cells[i].x - 1;
-      new_cell.y = cells[i].y - 1;
-      new_cell.R = (int)new_rgb.R/3;
-      new_cell.G = (int)new_rgb.G/3;
-      new_cell.B = (int)new_rgb.B/3;
-      new_cells.push_back(new_cell);
-    }
-  }
-
-  //PRINTLOG("#2 new_cells: %d\n", new_cells.size());
-
-  //remove duplicates
-  //TODO: This doesn't seem to be working correctly
-  //new_cells.erase( unique( new_cells.begin(), new_cells.end() ), new_cells.end());
-  int i = 0;
-  while(i < new_cells.size()) {
-    for(int j = i+1; j < new_cells.size(); j++) {
-      if(new_cells[i]==new_cells[j]) {
-        new_cells.erase(new_cells.begin()+j);
-      }
-
-    }
-    i++;
-  }
-
-  while(new_cells.size() > MAX_CELLS) {
-    new_cells.erase(new_cells.begin());
-  }
-  //PRINTLOG("new_cells size: %d\n", new_cells.size());
-
-  //for(int i = 0; i < new_cells.size(); i++) {
-  //  PRINTLOG("new_cells %d x: %f y: %f\n", i, new_cells[i].x, new_cells[i].y);
-  //}
-  // overwrite cells array with new generation, in reverse
-  //int size = new_cells.size();
-  //for(int i = 0; i < size; i++) {
-  //  cells[i] = new_cells[i];
-  //}
-  for(int i = 0; i < ncells; i++) {
-    removeSource(0);
-  }
-  for(int i = 0; i < new_cells.size(); i++) {
-    cells[i] = new_cells[i];
-  }
-  //if(ncells < new_cells.size()) {
-  ncells = new_cells.size();
-  //}
-  for(int i = 0; i < new_cells.size(); i++){
-    PRINTLOG("new_cell %d (x,y) (%f, %f)\n", i, new_cells[i].x, new_cells[i].y);
-  }
-  //PRINTLOG("ncells: %d new_cells: %d\n", ncells, new_cells.size());
+    colourNewCells();
 }
 
 
@@ -532,12 +431,21 @@ void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime) {
     uint8_t * fftBins = getFftBins();
 
 #define SKIP_COUNT 200
-    static int cnt = 0;
-    if (cnt < SKIP_COUNT){
-        cnt++;
+    if (warmupFrames < SKIP_COUNT){
+        warmupFrames++;
         return;
     }
 
+    // a stretch of silence is taken as the gap between two songs, the next song gets the next rule
+    bool silent = true;
+    for(i = 0; i < nColours; i++) {
+        silent = silent && fftBins[i] < SILENCE_LEVEL;
+    }
+    silentFrames = silent ? silentFrames + 1 : 0;
+    if(silentFrames == SONG_BREAK_FRAMES) {
+        nextRule();
+    }
+
     // Compute the sound power (or volume) in each bin
     for(i = 0; i < nColours; i++) {
         freq_bins[i].soundPower = fftBins[i];
@@ -564,14 +472,11 @@ void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime) {
         }
 
     }
-    for(int i = 0; i < ncells; i++) {
-      PRINTLOG("cell %d (x,y) (%f, %f)\n",i, cells[i].x, cells[i].y);
-    }
-
 
     // iterate through all the pals and render each one
+    gatherPanels();
     for(i = 0; i < layoutData->nPanels; i++) {
-        renderPanel(&layoutData->panels[i], &R, &G, &B);
+        renderPanel(i, &R, &G, &B);
         frames[i].panelId = layoutData->panels[i].panelId;
         frames[i].r = R;
         frames[i].g = G;
@@ -579,7 +484,7 @@ void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime) {
         frames[i].transTime = TRANSITION_TIME;
     }
 
-    // move all the light cells so they are ready for the next frame
+    // step the grid so it is ready for the next frame
     generateNextGeneration();
     // this algorithm renders every panel at every frame
     *nFrames = layoutData->nPanels;
@@ -590,5 +495,21 @@ void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime) {
  * Do all deallocation for memory allocated in initplugin here
  */
 void pluginCleanup() {
-    // do deallocation here, but there is nothing to deallocate
+    patternLibrary.unload();
+    // hand back the grid and the per cell and per panel tables, initPlugin builds them again
+    grid = LifeGrid();
+    std::vector<RGB_t>().swap(cellColours);
+    std::vector<int>().swap(cellPanel);
+    std::vector<int>().swap(panelCells);
+    std::vector<RGB_t>().swap(panelSum);
+    std::vector<int>().swap(panelLive);
+    std::vector<int>().swap(spawnPatterns);
+    rule = LifeRule();
+    ruleIndex = 0;
+    silentFrames = 0;
+    memset(freq_bins, 0, sizeof(freq_bins));
+    warmupFrames = 0;
+    layoutData = NULL;
+    paletteColours = NULL;
+    nColours = 0;
 }
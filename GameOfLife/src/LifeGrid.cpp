@@ -0,0 +1,126 @@
+/*
+ * LifeGrid.cpp
+ *
+ *  Description:
+ *  Bitboard Life grid, see LifeGrid.h.
+ */
+
+#include "LifeGrid.h"
+#include <algorithm>
+
+LifeGrid::LifeGrid() {
+    width = height = words = 0;
+}
+
+void LifeGrid::init(int gridWidth, int gridHeight) {
+    words = std::max((gridWidth + LIFE_WORD_BITS - 1) / LIFE_WORD_BITS, 1);
+    width = words * LIFE_WORD_BITS;
+    height = std::max(gridHeight, 1);
+    cells.assign(words * height, 0);
+    previous.assign(words * height, 0);
+}
+
+void LifeGrid::clear() {
+    std::fill(cells.begin(), cells.end(), 0);
+    std::fill(previous.begin(), previous.end(), 0);
+}
+
+void LifeGrid::set(int x, int y) {
+    x = ((x % width) + width) % width;
+    y = ((y % height) + height) % height;
+    cells[y * words + x / LIFE_WORD_BITS] |= (uint64_t)1 << (x % LIFE_WORD_BITS);
+}
+
+bool LifeGrid::get(int x, int y) const {
+    x = ((x % width) + width) % width;
+    y = ((y % height) + height) % height;
+    return (cells[y * words + x / LIFE_WORD_BITS] >> (x % LIFE_WORD_BITS)) & 1;
+}
+
+void LifeGrid::stamp(const uint64_t* rows, int wordsPerRow, int stampHeight, int x, int y) {
+    x = ((x % width) + width) % width;
+    y = ((y % height) + height) % height;
+    int shift = x % LIFE_WORD_BITS;
+    for(int r = 0; r < stampHeight; r++) {
+        uint64_t* out = &cells[((y + r) % height) * words];
+        for(int k = 0; k < wordsPerRow; k++) {
+            uint64_t bits = rows[r * wordsPerRow + k];
+            int w = (x / LIFE_WORD_BITS + k) % words;
+            out[w] |= bits << shift;
+            if(shift > 0) {
+                out[(w + 1) % words] |= bits >> (LIFE_WORD_BITS - shift);
+            }
+        }
+    }
+}
+
+/** sum and carry of three bit slices */
+static inline void fullAdd(uint64_t a, uint64_t b, uint64_t c, uint64_t* sum, uint64_t* carry) {
+    uint64_t ab = a ^ b;
+    *sum = ab ^ c;
+    *carry = (a & b) | (ab & c);
+}
+
+/** the row with every cell moved one to the east, i.e. bit x holds cell x - 1 */
+static inline uint64_t fromWest(const uint64_t* row, int w, int words) {
+    return (row[w] << 1) | (row[w > 0 ? w - 1 : words - 1] >> (LIFE_WORD_BITS - 1));
+}
+
+/** the row with every cell moved one to the west, i.e. bit x holds cell x + 1 */
+static inline uint64_t fromEast(const uint64_t* row, int w, int words) {
+    return (row[w] >> 1) | (row[w + 1 < words ? w + 1 : 0] << (LIFE_WORD_BITS - 1));
+}
+
+void LifeGrid::step(const LifeRule& rule) {
+    cells.swap(previous);
+    for(int y = 0; y < height; y++) {
+        const uint64_t* above = &previous[(y > 0 ? y - 1 : height - 1) * words];
+        const uint64_t* middle = &previous[y * words];
+        const uint64_t* below = &previous[(y + 1 < height ? y + 1 : 0) * words];
+        uint64_t* out = &cells[y * words];
+        for(int w = 0; w < words; w++) {
+            // add the eight neighbours up in bit slices: three full adders for the ones, then the carries
+            uint64_t s0, s1, s2, c0, c1, c2;
+            fullAdd(fromWest(above, w, words), above[w], fromEast(above, w, words), &s0, &c0);
+            fullAdd(fromWest(middle, w, words), fromEast(middle, w, words), fromWest(below, w, words), &s1, &c1);
+            uint64_t south = below[w];
+            uint64_t southEast = fromEast(below, w, words);
+            s2 = south ^ southEast;
+            c2 = south & southEast;
+            uint64_t count[4], twos, twosToo, fours, foursToo;
+            fullAdd(s0, s1, s2, &count[0], &twos);
+            fullAdd(c0, c1, c2, &twosToo, &fours);
+            foursToo = twos & twosToo;
+            count[1] = twos ^ twosToo;
+            count[2] = fours ^ foursToo;
+            count[3] = fours & foursToo;
+            out[w] = rule.evaluate(count, middle[w]);
+        }
+    }
+}
+
+void LifeGrid::stepLut(const LifeRule& rule) {
+    cells.swap(previous);
+    std::fill(cells.begin(), cells.end(), 0);
+    for(int y = 0; y < height; y++) {
+        const uint64_t* rows[3] = {
+            &previous[(y > 0 ? y - 1 : height - 1) * words],
+            &previous[y * words],
+            &previous[(y + 1 < height ? y + 1 : 0) * words]
+        };
+        for(int x = 0; x < width; x++) {
+            // bit 3 * dy + dx of the index is the neighbour at (x + dx - 1, y + dy - 1)
+            int neighbourhood = 0;
+            for(int dy = 0; dy < 3; dy++) {
+                for(int dx = 0; dx < 3; dx++) {
+                    int nx = (x + dx - 1 + width) % width;
+                    int bit = (rows[dy][nx / LIFE_WORD_BITS] >> (nx % LIFE_WORD_BITS)) & 1;
+                    neighbourhood |= bit << (3 * dy + dx);
+                }
+            }
+            if(rule.next(neighbourhood)) {
+                cells[y * words + x / LIFE_WORD_BITS] |= (uint64_t)1 << (x % LIFE_WORD_BITS);
+            }
+        }
+    }
+}
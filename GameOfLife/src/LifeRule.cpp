@@ -0,0 +1,153 @@
+/*
+ * LifeRule.cpp
+ *
+ *  Description:
+ *  Life rulestring compiler, see LifeRule.h.
+ */
+
+#include "LifeRule.h"
+#include <ctype.h>
+#include <string.h>
+
+#define LIFE_MAX_NEIGHBOURS 8
+
+/** rulestrings known by name */
+static const char* namedRules[][2] = {
+    {"conway", "B3/S23"},
+    {"life", "B3/S23"},
+    {"highlife", "B36/S23"},
+    {"day&night", "B3678/S34678"},
+    {"daynight", "B3678/S34678"},
+};
+
+static bool sameName(const char* a, const char* b) {
+    for(; *a && *b; a++, b++) {
+        if(tolower((unsigned char)*a) != tolower((unsigned char)*b)) {
+            return false;
+        }
+    }
+    return *a == *b;
+}
+
+/**
+ * @description: read the neighbour counts out of a rulestring
+ * @return: false if the string isn't a B/S or S/B rule
+ */
+static bool parseRule(const char* rulestring, uint16_t* born, uint16_t* survive) {
+    *born = *survive = 0;
+    bool letters = strpbrk(rulestring, "bBsS") != NULL;
+    uint16_t* target = letters ? NULL : survive;   // the S/B form starts with the survive counts
+    int slashes = 0;
+    for(const char* c = rulestring; *c; c++) {
+        if(*c == 'b' || *c == 'B') {
+            target = born;
+        } else if(*c == 's' || *c == 'S') {
+            target = survive;
+        } else if(*c == '/') {
+            slashes++;
+            if(!letters) {
+                target = born;
+            }
+        } else if(*c >= '0' && *c <= '0' + LIFE_MAX_NEIGHBOURS && target != NULL) {
+            *target |= 1 << (*c - '0');
+        } else if(*c != ' ') {
+            return false;
+        }
+    }
+    return letters ? slashes <= 1 : slashes == 1;
+}
+
+LifeRule::LifeRule() {
+    nOps = 0;
+    output = LIFE_REG_ZERO;
+    compile("B3/S23");
+}
+
+/**
+ * @description: turn a truth table into decision diagram nodes, sharing identical nodes
+ * @param table: the function over the inputs from level on, 2^(5 - level) entries, the input at this
+ * level is the most significant bit of the entry number
+ * @param level: 0 is the cell itself, 1 to 4 are the neighbour count bits from the top down
+ * @return: the register holding the function
+ */
+int LifeRule::buildNode(uint32_t table, int level) {
+    int entries = 1 << (5 - level);
+    uint32_t all = entries == 32 ? 0xffffffff : (1u << entries) - 1;
+    if(table == 0) {
+        return LIFE_REG_ZERO;
+    }
+    if(table == all) {
+        return LIFE_REG_ONE;
+    }
+    int half = entries / 2;
+    uint32_t loTable = table & ((1u << half) - 1);
+    uint32_t hiTable = table >> half;
+    if(loTable == hiTable) {
+        return buildNode(loTable, level + 1);
+    }
+    int lo = buildNode(loTable, level + 1);
+    int hi = buildNode(hiTable, level + 1);
+    int sel = level == 0 ? LIFE_REG_ALIVE : LIFE_REG_COUNT0 + 4 - level;
+    if(lo == LIFE_REG_ZERO && hi == LIFE_REG_ONE) {
+        return sel;
+    }
+    for(int k = 0; k < nOps; k++) {
+        if(ops[k].sel == sel && ops[k].lo == lo && ops[k].hi == hi) {
+            return LIFE_REG_FIRST_OP + k;
+        }
+    }
+    ops[nOps].sel = sel;
+    ops[nOps].lo = lo;
+    ops[nOps].hi = hi;
+    return LIFE_REG_FIRST_OP + nOps++;
+}
+
+bool LifeRule::compile(const char* rulestring) {
+    for(size_t i = 0; i < sizeof(namedRules) / sizeof(namedRules[0]); i++) {
+        if(sameName(rulestring, namedRules[i][0])) {
+            rulestring = namedRules[i][1];
+        }
+    }
+    uint16_t newBorn, newSurvive;
+    if(!parseRule(rulestring, &newBorn, &newSurvive)) {
+        return false;
+    }
+    born = newBorn;
+    survive = newSurvive;
+
+    char* end = name;
+    *end++ = 'B';
+    for(int n = 0; n <= LIFE_MAX_NEIGHBOURS; n++) {
+        if(born & (1 << n)) {
+            *end++ = '0' + n;
+        }
+    }
+    *end++ = '/';
+    *end++ = 'S';
+    for(int n = 0; n <= LIFE_MAX_NEIGHBOURS; n++) {
+        if(survive & (1 << n)) {
+            *end++ = '0' + n;
+        }
+    }
+    *end = 0;
+
+    for(int i = 0; i < LIFE_LUT_SIZE; i++) {
+        int count = __builtin_popcount(i & ~0x10);
+        lut[i] = ((i & 0x10 ? survive : born) >> count) & 1;
+    }
+
+    // truth table over (alive, count), entry alive * 16 + count. Counts above 8 can't happen, they copy
+    // count - 8 so the top count bit drops out of the network altogether whenever 8 does the same as 0
+    uint32_t table = 0;
+    for(int alive = 0; alive < 2; alive++) {
+        for(int count = 0; count < 16; count++) {
+            int n = count > LIFE_MAX_NEIGHBOURS ? count - LIFE_MAX_NEIGHBOURS : count;
+            if(((alive ? survive : born) >> n) & 1) {
+                table |= 1u << (alive * 16 + count);
+            }
+        }
+    }
+    nOps = 0;
+    output = buildNode(table, 0);
+    return true;
+}
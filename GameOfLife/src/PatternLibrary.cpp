@@ -0,0 +1,392 @@
+/*
+ * PatternLibrary.cpp
+ *
+ *  Description:
+ *  RLE pattern corpus compiled into a mappable stamp cache, see PatternLibrary.h.
+ */
+
+#include "PatternLibrary.h"
+#include "Logger.h"
+#include <algorithm>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define RLE_READ_CHUNK 4096
+#define STAMP_WORD_BITS 64
+#define FNV_OFFSET 14695981039346656037ull
+#define FNV_PRIME 1099511628211ull
+
+/** patterns that are always there, whatever is in the corpus */
+static const char* builtinPatterns[][2] = {
+    // spaceships
+    {"glider", "bo$2bo$3o!"},
+    {"lightweight spaceship", "o2bo$4bo$o3bo$b4o!"},
+    // oscillators
+    {"blinker", "3o!"},
+    {"toad", "b3o$3o!"},
+    // still lifes
+    {"block", "2o$2o!"},
+    {"beehive", "b2o$o2bo$b2o!"},
+};
+
+/**
+ * Streaming RLE parser: the text can be fed in in pieces of any size (a line can be split anywhere) and
+ * the live cells come out as it goes. Understands #N name lines, skips other # lines and the x = .. header,
+ * and takes o as well as the multi state letters A to X as live.
+ */
+class RleReader {
+public:
+    RleReader() : lineStart(true), skipLine(false), afterHash(false), nameLine(false), done(false),
+                  run(0), x(0), y(0) {}
+
+    void feed(const char* data, size_t n) {
+        for(size_t i = 0; i < n && !done; i++) {
+            char c = data[i];
+            if(c == '\n' || c == '\r') {
+                lineStart = true;
+                skipLine = afterHash = nameLine = false;
+                continue;
+            }
+            if(lineStart) {
+                lineStart = false;
+                if(c == '#' || c == 'x') {
+                    skipLine = true;
+                    afterHash = c == '#';
+                    continue;
+                }
+            }
+            if(skipLine) {
+                if(afterHash && c == 'N') {
+                    nameLine = true;
+                    name.clear();
+                } else if(nameLine && !(name.empty() && c == ' ')) {
+                    name += c;
+                }
+                afterHash = false;
+                continue;
+            }
+            int count = run > 0 ? run : 1;
+            if(c >= '0' && c <= '9') {
+                run = run * 10 + (c - '0');
+                continue;
+            } else if(c == 'o' || (c >= 'A' && c <= 'X')) {
+                for(int k = 0; k < count; k++) {
+                    cellX.push_back(x++);
+                    cellY.push_back(y);
+                }
+            } else if(c == 'b' || c == '.') {
+                x += count;
+            } else if(c == '$') {
+                y += count;
+                x = 0;
+            } else if(c == '!') {
+                done = true;
+            }
+            run = 0;
+        }
+    }
+
+    std::string name;
+    std::vector<int> cellX, cellY;
+
+private:
+    bool lineStart, skipLine, afterHash, nameLine, done;
+    int run, x, y;
+};
+
+/** the compiled library, before it is laid out flat */
+struct library_builder_t {
+    std::vector<stamp_pattern_t> patterns;
+    std::vector<stamp_t> stamps;
+    std::vector<uint64_t> words;
+};
+
+/**
+ * @description: compile the cells read from one pattern into its distinct orientations
+ */
+static void addPattern(library_builder_t* library, const std::string& name, const std::vector<int>& cellX,
+                       const std::vector<int>& cellY) {
+    if(cellX.empty()) {
+        PRINTLOG("Pattern %s has no live cells, skipping it\n", name.c_str());
+        return;
+    }
+    int minX = *std::min_element(cellX.begin(), cellX.end());
+    int minY = *std::min_element(cellY.begin(), cellY.end());
+    int w = *std::max_element(cellX.begin(), cellX.end()) - minX + 1;
+    int h = *std::max_element(cellY.begin(), cellY.end()) - minY + 1;
+    if(w > STAMP_MAX_SIDE || h > STAMP_MAX_SIDE) {
+        PRINTLOG("Pattern %s is %d x %d, too big for a stamp\n", name.c_str(), w, h);
+        return;
+    }
+
+    stamp_pattern_t pattern;
+    memset(&pattern, 0, sizeof(pattern));
+    strncpy(pattern.name, name.c_str(), STAMP_NAME_LENGTH - 1);
+    pattern.width = w;
+    pattern.height = h;
+    pattern.firstStamp = library->stamps.size();
+
+    std::vector<uint64_t> rows;
+    for(int orientation = 0; orientation < STAMP_ORIENTATIONS; orientation++) {
+        // orientations 0 to 3 turn the pattern by a quarter each time, 4 to 7 do the same to its mirror image
+        bool turned = orientation & 1;
+        stamp_t s;
+        memset(&s, 0, sizeof(s));
+        s.width = turned ? h : w;
+        s.height = turned ? w : h;
+        s.wordsPerRow = (s.width + STAMP_WORD_BITS - 1) / STAMP_WORD_BITS;
+        rows.assign(s.height * s.wordsPerRow, 0);
+        for(size_t i = 0; i < cellX.size(); i++) {
+            int px = cellX[i] - minX;
+            int py = cellY[i] - minY;
+            if(orientation >= 4) {
+                px = w - 1 - px;
+            }
+            int sx, sy;
+            switch(orientation & 3) {
+            case 0: sx = px;         sy = py;         break;
+            case 1: sx = h - 1 - py; sy = px;         break;
+            case 2: sx = w - 1 - px; sy = h - 1 - py; break;
+            default: sx = py;        sy = w - 1 - px; break;
+            }
+            uint64_t& word = rows[sy * s.wordsPerRow + sx / STAMP_WORD_BITS];
+            uint64_t bit = (uint64_t)1 << (sx % STAMP_WORD_BITS);
+            if(!(word & bit)) {
+                word |= bit;
+                s.cells++;
+            }
+        }
+
+        // symmetric patterns look the same in several orientations, only keep the first of each
+        bool seen = false;
+        for(uint32_t k = pattern.firstStamp; k < library->stamps.size() && !seen; k++) {
+            const stamp_t& other = library->stamps[k];
+            seen = other.width == s.width && other.height == s.height &&
+                   std::equal(rows.begin(), rows.end(), library->words.begin() + other.firstWord);
+        }
+        if(!seen) {
+            s.firstWord = library->words.size();
+            library->words.insert(library->words.end(), rows.begin(), rows.end());
+            library->stamps.push_back(s);
+        }
+    }
+    pattern.cells = library->stamps[pattern.firstStamp].cells;
+    pattern.nStamps = library->stamps.size() - pattern.firstStamp;
+    library->patterns.push_back(pattern);
+}
+
+/**
+ * @description: parse one .rle file a chunk at a time
+ */
+static void addPatternFile(library_builder_t* library, const std::string& path, const std::string& fileName) {
+    FILE* file = fopen(path.c_str(), "r");
+    if(file == NULL) {
+        PRINTLOG("Can't open pattern %s\n", path.c_str());
+        return;
+    }
+    RleReader reader;
+    char chunk[RLE_READ_CHUNK];
+    size_t n;
+    while((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        reader.feed(chunk, n);
+    }
+    fclose(file);
+    addPattern(library, reader.name.empty() ? fileName.substr(0, fileName.size() - 4) : reader.name,
+               reader.cellX, reader.cellY);
+}
+
+/** FNV-1a, folding data into hash */
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t n) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for(size_t i = 0; i < n; i++) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static bool isRleFile(const std::string& fileName) {
+    return fileName.size() > 4 && fileName.compare(fileName.size() - 4, 4, ".rle") == 0;
+}
+
+PatternLibrary::PatternLibrary() {
+    header = NULL;
+    patterns = NULL;
+    stamps = NULL;
+    words = NULL;
+    mapped = NULL;
+    mappedSize = 0;
+}
+
+PatternLibrary::~PatternLibrary() {
+    unload();
+}
+
+void PatternLibrary::unload() {
+    if(mapped != NULL) {
+        munmap(mapped, mappedSize);
+        mapped = NULL;
+        mappedSize = 0;
+    }
+    std::vector<uint64_t>().swap(memoryImage);
+    header = NULL;
+    patterns = NULL;
+    stamps = NULL;
+    words = NULL;
+}
+
+bool PatternLibrary::attach(const uint8_t* data, size_t size) {
+    if(size < sizeof(stamp_cache_header_t)) {
+        return false;
+    }
+    const stamp_cache_header_t* h = (const stamp_cache_header_t*)data;
+    if(memcmp(h->magic, STAMP_CACHE_MAGIC, sizeof(h->magic)) != 0 || h->version != STAMP_CACHE_VERSION) {
+        return false;
+    }
+    size_t expected = sizeof(stamp_cache_header_t) + h->nPatterns * sizeof(stamp_pattern_t) +
+                      h->nStamps * sizeof(stamp_t) + h->nWords * sizeof(uint64_t);
+    if(size != expected) {
+        return false;
+    }
+    const stamp_pattern_t* p = (const stamp_pattern_t*)(h + 1);
+    const stamp_t* s = (const stamp_t*)(p + h->nPatterns);
+    const uint64_t* w = (const uint64_t*)(s + h->nStamps);
+    // a damaged cache must not send a stamp outside the file
+    for(uint32_t i = 0; i < h->nPatterns; i++) {
+        if(p[i].nStamps == 0 || p[i].firstStamp + p[i].nStamps > h->nStamps) {
+            return false;
+        }
+    }
+    for(uint32_t i = 0; i < h->nStamps; i++) {
+        if(s[i].firstWord + (size_t)s[i].height * s[i].wordsPerRow > h->nWords) {
+            return false;
+        }
+    }
+    header = h;
+    patterns = p;
+    stamps = s;
+    words = w;
+    return true;
+}
+
+bool PatternLibrary::mapCache(const char* cachePath, uint32_t nCorpusFiles, uint64_t corpusHash) {
+    struct stat info;
+    if(stat(cachePath, &info) != 0 || info.st_size == 0) {
+        return false;
+    }
+    int fd = open(cachePath, O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+    void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) {
+        return false;
+    }
+    if(!attach((const uint8_t*)data, info.st_size) || header->nCorpusFiles != nCorpusFiles ||
+            header->corpusHash != corpusHash) {
+        munmap(data, info.st_size);
+        header = NULL;
+        return false;
+    }
+    mapped = data;
+    mappedSize = info.st_size;
+    return true;
+}
+
+int PatternLibrary::load(const char* corpusDir, const char* cachePath) {
+    unload();
+
+    // the corpus, in name order so the pattern numbers don't depend on the directory order
+    std::vector<std::string> files;
+    DIR* dir = corpusDir != NULL ? opendir(corpusDir) : NULL;
+    if(dir != NULL) {
+        struct dirent* entry;
+        while((entry = readdir(dir)) != NULL) {
+            std::string fileName = entry->d_name;
+            if(isRleFile(fileName)) {
+                files.push_back(fileName);
+            }
+        }
+        closedir(dir);
+    }
+    std::sort(files.begin(), files.end());
+
+    // what the cache has to have been built from
+    uint64_t corpusHash = FNV_OFFSET;
+    for(size_t i = 0; i < files.size(); i++) {
+        struct stat info;
+        int64_t size = -1, modified = -1;
+        if(stat((std::string(corpusDir) + "/" + files[i]).c_str(), &info) == 0) {
+            size = info.st_size;
+            modified = info.st_mtime;
+        }
+        corpusHash = hashBytes(corpusHash, files[i].c_str(), files[i].size() + 1);
+        corpusHash = hashBytes(corpusHash, &size, sizeof(size));
+        corpusHash = hashBytes(corpusHash, &modified, sizeof(modified));
+    }
+    uint32_t nCorpusFiles = files.size();
+
+    if(cachePath != NULL && mapCache(cachePath, nCorpusFiles, corpusHash)) {
+        return nPatterns();
+    }
+
+    library_builder_t library;
+    for(size_t i = 0; i < sizeof(builtinPatterns) / sizeof(builtinPatterns[0]); i++) {
+        RleReader reader;
+        reader.feed(builtinPatterns[i][1], strlen(builtinPatterns[i][1]));
+        addPattern(&library, builtinPatterns[i][0], reader.cellX, reader.cellY);
+    }
+    for(size_t i = 0; i < files.size(); i++) {
+        addPatternFile(&library, std::string(corpusDir) + "/" + files[i], files[i]);
+    }
+
+    // lay it all out flat; every part is a multiple of 8 bytes so the words stay aligned
+    stamp_cache_header_t h;
+    memcpy(h.magic, STAMP_CACHE_MAGIC, sizeof(h.magic));
+    h.version = STAMP_CACHE_VERSION;
+    h.nPatterns = library.patterns.size();
+    h.nStamps = library.stamps.size();
+    h.nWords = library.words.size();
+    h.nCorpusFiles = nCorpusFiles;
+    h.reserved = 0;
+    h.corpusHash = corpusHash;
+    size_t size = sizeof(h) + h.nPatterns * sizeof(stamp_pattern_t) + h.nStamps * sizeof(stamp_t) +
+                  h.nWords * sizeof(uint64_t);
+    memoryImage.assign(size / sizeof(uint64_t), 0);
+    uint8_t* out = (uint8_t*)&memoryImage[0];
+    memcpy(out, &h, sizeof(h));
+    out += sizeof(h);
+    if(h.nPatterns > 0) {
+        memcpy(out, &library.patterns[0], h.nPatterns * sizeof(stamp_pattern_t));
+        out += h.nPatterns * sizeof(stamp_pattern_t);
+    }
+    if(h.nStamps > 0) {
+        memcpy(out, &library.stamps[0], h.nStamps * sizeof(stamp_t));
+        out += h.nStamps * sizeof(stamp_t);
+    }
+    if(h.nWords > 0) {
+        memcpy(out, &library.words[0], h.nWords * sizeof(uint64_t));
+    }
+
+    // write the cache next to where it is going, then move it in place so nobody maps half a file
+    if(cachePath != NULL) {
+        std::string temporary = std::string(cachePath) + ".tmp";
+        FILE* file = fopen(temporary.c_str(), "wb");
+        bool written = file != NULL && fwrite(&memoryImage[0], 1, size, file) == size;
+        written = file != NULL && fclose(file) == 0 && written;
+        if(written && rename(temporary.c_str(), cachePath) == 0 && mapCache(cachePath, nCorpusFiles, corpusHash)) {
+            std::vector<uint64_t>().swap(memoryImage);
+            return nPatterns();
+        }
+        unlink(temporary.c_str());
+        PRINTLOG("Can't write the pattern cache %s, keeping the patterns in memory\n", cachePath);
+    }
+    attach((const uint8_t*)&memoryImage[0], size);
+    return nPatterns();
+}
@@ -190,5 +190,12 @@ void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime){
  * Do all deallocation for memory allocated in initplugin here
  */
 void pluginCleanup(){
-	//do deallocation here
+	delete [] sources;
+	sources = NULL;
+	nSources = 0; // initPlugin counts its source up from here
+	toggle = false;
+	toggle1 = false;
+	layoutData = NULL;
+	palettenColors = NULL;
+	nColors = 0;
 }
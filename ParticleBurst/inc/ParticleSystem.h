@@ -0,0 +1,74 @@
+/*
+ * ParticleSystem.h
+ *
+ *  Description:
+ *  Particles with a position, velocity, colour, age and lifetime. Every attribute lives in its own array
+ *  (structure of arrays), so moving the particles is a few straight loops over floats that the compiler
+ *  vectorizes. Particles bounce off the edges of the layout: a LatticeMap tells which lattice cells are
+ *  covered by a panel, and a particle about to step onto an uncovered cell has its velocity reflected.
+ *  Dead particles are removed by moving the last particle into their slot, so removal is O(1) and the
+ *  arrays stay packed.
+ */
+
+#ifndef INC_PARTICLESYSTEM_H_
+#define INC_PARTICLESYSTEM_H_
+
+#include "LatticeMap.h"
+#include <vector>
+
+class ParticleSystem {
+public:
+    ParticleSystem();
+
+    /**
+     * @description: allocate the particle arrays, with no particles in them
+     * @param capacity: maximum number of live particles, new particles are dropped when full
+     */
+    void init(int capacity);
+
+    /** @description: remove all particles */
+    void clear();
+
+    /** @description: free the particle arrays, init() has to be called again before use */
+    void release();
+
+    /**
+     * @description: spray particles out of a point in random directions
+     * @param x, y: where the burst starts
+     * @param count: number of particles
+     * @param speed: speed of the particles, in layout units per frame
+     * @param R, G, B: colour of the particles
+     * @param lifetime: number of frames the particles live
+     */
+    void burst(float x, float y, int count, float speed, float R, float G, float B, float lifetime);
+
+    /**
+     * @description: move every particle one frame on, bounce it off the layout edges and remove the dead ones
+     * @param map: which lattice cells lie on a panel
+     * @param drag: fraction of the velocity kept every frame
+     */
+    void update(const LatticeMap& map, float drag);
+
+    /**
+     * @description: add the light of every particle to the panel it is over, faded by its age
+     * @param map: the lattice to panel map
+     * @param R, G, B: one accumulator per panel, in layoutData->panels order
+     */
+    void splat(const LatticeMap& map, float* R, float* G, float* B) const;
+
+    int size() const { return n; }
+
+    std::vector<float> x, y;        // position
+    std::vector<float> vx, vy;      // velocity, per frame
+    std::vector<float> R, G, B;     // colour
+    std::vector<float> age;         // frames lived
+    std::vector<float> lifetime;    // frames to live
+
+private:
+    void removeAt(int i);
+
+    int n;
+    int capacity;
+};
+
+#endif /* INC_PARTICLESYSTEM_H_ */
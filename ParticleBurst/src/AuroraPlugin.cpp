@@ -0,0 +1,268 @@
+/**
+    Copyright 2017 Nanoleaf Ltd.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http:www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+    AuroraPlugin.cpp
+
+    Description:
+    Every beat sprays a burst of particles out of a random panel, coloured by the frequency band that beat.
+    The particles fly over the layout, slow down, bounce off its edges and fade out; each panel shows the
+    light of the particles over it. Beat detection is the same as DancingTiles'. The particles are kept in
+    a structure of arrays (see ParticleSystem.h) so tens of thousands of them are cheap to move, which is
+    useful when the plugin is driving a large wall from a host.
+ */
+
+
+#include "AuroraPlugin.h"
+#include "LayoutProcessingUtils.h"
+#include "ColorUtils.h"
+#include "DataManager.h"
+#include <stdlib.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "Logger.h"
+#include "PluginFeatures.h"
+#include "LatticeMap.h"
+#include "ParticleSystem.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    void initPlugin();
+    void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime);
+    void pluginCleanup();
+
+#ifdef __cplusplus
+}
+#endif
+
+#define TRANSITION_TIME 1  // the transition time to send to panels; set to 100ms currently
+#define MINIMUM_INTENSITY 0.2  // the minimum intensity of a burst
+#define TRIGGER_THRESHOLD 0.7 // used to calculate whether a band beat
+//Particle consts
+#define MAX_PARTICLES 16384 //particles alive at once, bursts are cut short when full
+#define PARTICLES_PER_BEAT 200 //particles in a burst at full intensity
+#define PARTICLE_SPEED 20.0 //initial speed in layout units per frame, a panel is about 86 across
+#define PARTICLE_DRAG 0.93 //fraction of its speed a particle keeps each frame
+#define PARTICLE_LIFETIME 25 //frames a particle lives
+#define PARTICLE_BRIGHTNESS 0.15 //share of its colour a single particle adds to its panel
+#define PARTICLE_GRID 256 //the layout is split into PARTICLE_GRID x PARTICLE_GRID cells for the edge checks
+
+/** Here we store the information accociated with each frequency bin. This
+ allows for tracking a degree of historical information.
+ */
+typedef struct {
+    uint32_t latest_minimum;
+    uint32_t soundPower;
+    uint32_t runningMax;
+    uint32_t maximumTrigger;
+    uint32_t previousPower;
+    uint32_t secondPreviousPower;
+} freq_bin;
+
+static RGB_t* paletteColours = NULL; // this is our saved pointer to the colour palette
+static int nColours = 0;             // the number of colours in the palette
+static LayoutData *layoutData; // this is our saved pointer to the panel layout information
+static freq_bin* freqBins = NULL; // this is our array for frequency bin historical information
+static ParticleSystem particles; // allocated in initPlugin, freed in pluginCleanup
+static LatticeMap latticeMap; // which grid cells are over a panel, the particles bounce off the rest
+static float* panelR = NULL; // light gathered on each panel this frame
+static float* panelG = NULL;
+static float* panelB = NULL;
+static int warmupFrames = 0; // frames skipped so far, see SKIP_COUNT
+
+/**
+  * @description: add a value to a running max.
+  * @param: runningMax is current runningMax, valueToAdd is added to runningMax, effectiveTrail
+  *         defines how many values are effectively tracked. Note this is an approximation.
+  * @return: int returned as new runningMax.
+  */
+int addToRunningMax(int runningMax, int valueToAdd, int effectiveTrail) {
+    int trail = effectiveTrail;
+    if (valueToAdd > runningMax && effectiveTrail > 1) {
+        trail = trail / 2;
+    }
+    return runningMax - ((float)runningMax / effectiveTrail) + ((float)valueToAdd / trail);
+}
+
+/**
+ * @description: Initialize the plugin. Called once, when the plugin is loaded.
+ * This function can be used to enable rhythm or advanced features,
+ * e.g., to enable energy feature, simply call enableEnergy()
+ * It can also be used to load the LayoutData and the colorPalette from the DataManager.
+ * Any allocation, if done here, should be deallocated in the plugin cleanup function
+ *
+ */
+void initPlugin() {
+    getColorPalette(&paletteColours, &nColours);  // grab the palette colours and store a pointer to them for later use
+    layoutData = getLayoutData(); // grab the layout data and store a pointer to it for later use
+
+    PRINTLOG("The layout has %d panels:\n", layoutData->nPanels);
+    for (int i = 0; i < layoutData->nPanels; i++) {
+        PRINTLOG("   Id: %d   X, Y: %lf, %lf\n", layoutData->panels[i].panelId,
+               layoutData->panels[i].shape->getCentroid().x, layoutData->panels[i].shape->getCentroid().y);
+    }
+
+    latticeMap.build(layoutData, PARTICLE_GRID);
+    particles.init(MAX_PARTICLES);
+    panelR = new float[layoutData->nPanels];
+    panelG = new float[layoutData->nPanels];
+    panelB = new float[layoutData->nPanels];
+
+    freqBins = new freq_bin[nColours];
+    // here we initialize our freqency bin values so that the plugin starts working reasonably well right away
+    for (int i = 0; i < nColours; i++) {
+        memset(&freqBins[i], 0, sizeof(freq_bin));
+        freqBins[i].runningMax = 50;
+        freqBins[i].maximumTrigger = 1;
+    }
+    enableFft(nColours);
+    enableBeatFeatures();
+}
+
+/**
+  * A simple algorithm to detect beats. It finds a strong signal after a period of quietness.
+  * See DancingTiles for the details.
+  */
+int16_t beat_detector(int i)
+{
+    int16_t beat_detected = 0;
+
+    //Check for local maximum and if observed, add to running average
+    if((freqBins[i].soundPower + (freqBins[i].runningMax / 4) < freqBins[i].previousPower) && (freqBins[i].previousPower > freqBins[i].secondPreviousPower)){
+        freqBins[i].runningMax = addToRunningMax(freqBins[i].runningMax, freqBins[i].previousPower, 4);
+    }
+
+    // update latest minimum.
+    if(freqBins[i].soundPower < freqBins[i].latest_minimum) {
+        freqBins[i].latest_minimum = freqBins[i].soundPower;
+    }
+    else if(freqBins[i].latest_minimum > 0) {
+        freqBins[i].latest_minimum--;
+    }
+
+    // criteria for a "beat"; value must exceed minimum plus a threshold of the runningMax.
+    if(freqBins[i].soundPower > freqBins[i].latest_minimum + (freqBins[i].runningMax * TRIGGER_THRESHOLD)) {
+        freqBins[i].latest_minimum = freqBins[i].soundPower;
+        beat_detected = 1;
+    }
+
+    // update historical information
+    freqBins[i].secondPreviousPower = freqBins[i].previousPower;
+    freqBins[i].previousPower = freqBins[i].soundPower;
+
+    return beat_detected;
+}
+
+/**
+ * @description: spray a burst out of the centre of a random panel
+ * @param paletteIndex: the band that beat, picks the colour
+ * @param intensity: 0 to 1, scales the number of particles
+ */
+void emitBurst(int paletteIndex, float intensity) {
+    if(layoutData->nPanels < 1) {
+        return;
+    }
+    int n1 = drand48() * layoutData->nPanels;
+    Point centre = layoutData->panels[n1].shape->getCentroid();
+    RGB_t colour = paletteColours[paletteIndex];
+    particles.burst(centre.x, centre.y, PARTICLES_PER_BEAT * intensity, PARTICLE_SPEED,
+                    colour.R, colour.G, colour.B, PARTICLE_LIFETIME);
+}
+
+/** clamp a gathered colour channel to what a panel can show */
+static inline int clampChannel(float value) {
+    return value > 255 ? 255 : (int)value;
+}
+
+/**
+ * @description: this the 'main' function that gives a frame to the Aurora to display onto the panels
+ * If the plugin is a sound visualization plugin, the sleepTime variable will be NULL and is not required to be
+ * filled in
+ * This function, if is an effects plugin, can specify the interval it is to be called at through the sleepTime variable
+ * if its a sound visualization plugin, this function is called at an interval of 50ms or more.
+ *
+ * @param frames: a pre-allocated buffer of the Frame_t structure to fill up with RGB values to show on panels.
+ * Maximum size of this buffer is equal to the number of panels
+ * @param nFrames: fill with the number of frames in frames
+ * @param sleepTime: specify interval after which this function is called again, NULL if sound visualization plugin
+ */
+void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime) {
+    uint8_t * fftBins = getFftBins();
+
+#define SKIP_COUNT 50
+    if (warmupFrames < SKIP_COUNT){
+        warmupFrames++;
+        return;
+    }
+
+    for(int i = 0; i < nColours; i++) {
+        freqBins[i].soundPower = fftBins[i];
+        if(beat_detector(i)) {
+            if (freqBins[i].soundPower > freqBins[i].maximumTrigger) {
+                freqBins[i].maximumTrigger = freqBins[i].soundPower;
+            }
+
+            float intensity = 1.0;
+
+            //calculate an intensity ranging from minimum to 1, using log scale
+            if (freqBins[i].soundPower > 1 && freqBins[i].runningMax > 1){
+                intensity = ((log((float)freqBins[i].soundPower) / log((float)freqBins[i].runningMax)) * (1.0 - MINIMUM_INTENSITY)) + MINIMUM_INTENSITY;
+            }
+
+            if (intensity > 1.0) {
+                intensity = 1.0;
+            }
+            emitBurst(i, intensity);
+        }
+    }
+
+    particles.update(latticeMap, PARTICLE_DRAG);
+
+    memset(panelR, 0, sizeof(float) * layoutData->nPanels);
+    memset(panelG, 0, sizeof(float) * layoutData->nPanels);
+    memset(panelB, 0, sizeof(float) * layoutData->nPanels);
+    particles.splat(latticeMap, panelR, panelG, panelB);
+
+    for(int i = 0; i < layoutData->nPanels; i++) {
+        frames[i].panelId = layoutData->panels[i].panelId;
+        frames[i].r = clampChannel(panelR[i] * PARTICLE_BRIGHTNESS);
+        frames[i].g = clampChannel(panelG[i] * PARTICLE_BRIGHTNESS);
+        frames[i].b = clampChannel(panelB[i] * PARTICLE_BRIGHTNESS);
+        frames[i].transTime = TRANSITION_TIME;
+    }
+    *nFrames = layoutData->nPanels;
+}
+
+/**
+ * @description: called once when the plugin is being closed.
+ * Do all deallocation for memory allocated in initplugin here
+ */
+void pluginCleanup() {
+    delete [] freqBins;
+    freqBins = NULL;
+    delete [] panelR;
+    delete [] panelG;
+    delete [] panelB;
+    panelR = panelG = panelB = NULL;
+    particles.release();
+    latticeMap = LatticeMap();
+    warmupFrames = 0;
+    layoutData = NULL;
+    paletteColours = NULL;
+    nColours = 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * LatticeMap.cpp
+ *
+ *  Description:
+ *  Lattice cell to panel map, see LatticeMap.h.
+ */
+
+#include "LatticeMap.h"
+#include <algorithm>
+#include <string.h>
+
+LatticeMap::LatticeMap() {
+    size = 0;
+    nPanels = 0;
+    originX = originY = 0;
+    cellSize = 1;
+}
+
+void LatticeMap::toLattice(float x, float y, int* cx, int* cy) const {
+    *cx = std::min(std::max((int)((x - originX) / cellSize), 0), size - 1);
+    *cy = std::min(std::max((int)((y - originY) / cellSize), 0), size - 1);
+}
+
+void LatticeMap::build(LayoutData* layoutData, int latticeSize) {
+    size = latticeSize;
+    nPanels = layoutData->nPanels;
+    cellPanel.assign(size * size, -1);
+    panelCells.assign(nPanels, 0);
+    if(nPanels == 0) {
+        return;
+    }
+
+    // bounding box over all the panel corners
+    geometry.build(layoutData);
+    geometry_box_t box = geometry.bounds();
+    cellSize = std::max(box.maxX - box.minX, box.maxY - box.minY) / size;
+    if(cellSize <= 0) {
+        cellSize = 1;
+    }
+    originX = box.minX;
+    originY = box.minY;
+    geometry.rasterize(originX, originY, cellSize, size, &cellPanel, &panelCells);
+}
+
+void LatticeMap::average(const float* plane, float* out) const {
+    memset(out, 0, sizeof(float) * nPanels);
+    int nCells = size * size;
+    for(int c = 0; c < nCells; c++) {
+        int panel = cellPanel[c];
+        if(panel >= 0) {
+            out[panel] += plane[c];
+        }
+    }
+    for(int i = 0; i < nPanels; i++) {
+        if(panelCells[i] > 0) {
+            out[i] /= panelCells[i];
+        }
+    }
+}
@@ -0,0 +1,131 @@
+/*
+ * ParticleSystem.cpp
+ *
+ *  Description:
+ *  Structure of arrays particle system, see ParticleSystem.h.
+ */
+
+#include "ParticleSystem.h"
+#include <math.h>
+#include <stdlib.h>
+
+ParticleSystem::ParticleSystem() {
+    n = 0;
+    capacity = 0;
+}
+
+void ParticleSystem::init(int maxParticles) {
+    std::vector<float>* arrays[] = {&x, &y, &vx, &vy, &R, &G, &B, &age, &lifetime};
+    for(size_t a = 0; a < sizeof(arrays) / sizeof(arrays[0]); a++) {
+        arrays[a]->assign(maxParticles, 0);
+    }
+    n = 0;
+    capacity = maxParticles;
+}
+
+void ParticleSystem::clear() {
+    n = 0;
+}
+
+void ParticleSystem::release() {
+    std::vector<float>* arrays[] = {&x, &y, &vx, &vy, &R, &G, &B, &age, &lifetime};
+    for(size_t a = 0; a < sizeof(arrays) / sizeof(arrays[0]); a++) {
+        std::vector<float>().swap(*arrays[a]);
+    }
+    n = 0;
+    capacity = 0;
+}
+
+void ParticleSystem::burst(float bx, float by, int count, float speed, float bR, float bG, float bB, float life) {
+    for(int k = 0; k < count && n < capacity; k++) {
+        float angle = drand48() * 2 * M_PI;
+        float s = speed * (0.5 + drand48() * 0.5);  // a spread of speeds looks less like a ring
+        x[n] = bx;
+        y[n] = by;
+        vx[n] = cos(angle) * s;
+        vy[n] = sin(angle) * s;
+        R[n] = bR;
+        G[n] = bG;
+        B[n] = bB;
+        age[n] = 0;
+        lifetime[n] = life;
+        n++;
+    }
+}
+
+void ParticleSystem::removeAt(int i) {
+    n--;
+    x[i] = x[n];
+    y[i] = y[n];
+    vx[i] = vx[n];
+    vy[i] = vy[n];
+    R[i] = R[n];
+    G[i] = G[n];
+    B[i] = B[n];
+    age[i] = age[n];
+    lifetime[i] = lifetime[n];
+}
+
+/** true if the point lies over a panel */
+static inline bool onLayout(const LatticeMap& map, float px, float py) {
+    int cx, cy;
+    map.toLattice(px, py, &cx, &cy);
+    return map.cellPanel[cy * map.size + cx] >= 0;
+}
+
+void ParticleSystem::update(const LatticeMap& map, float drag) {
+    float* __restrict__ px = x.data();
+    float* __restrict__ py = y.data();
+    float* __restrict__ pvx = vx.data();
+    float* __restrict__ pvy = vy.data();
+    float* __restrict__ page = age.data();
+
+    // bounce: a particle that would step off the layout has the offending velocity component reflected.
+    // Trying each axis on its own tells which wall it hit.
+    for(int i = 0; i < n; i++) {
+        if(onLayout(map, px[i] + pvx[i], py[i] + pvy[i])) {
+            continue;
+        }
+        bool blockedX = !onLayout(map, px[i] + pvx[i], py[i]);
+        bool blockedY = !onLayout(map, px[i], py[i] + pvy[i]);
+        if(blockedX || !blockedY) {
+            pvx[i] = -pvx[i];
+        }
+        if(blockedY || !blockedX) {
+            pvy[i] = -pvy[i];
+        }
+    }
+
+    // explicit Euler step, straight loops over the arrays
+    for(int i = 0; i < n; i++) {
+        px[i] += pvx[i];
+        py[i] += pvy[i];
+    }
+    for(int i = 0; i < n; i++) {
+        pvx[i] *= drag;
+        pvy[i] *= drag;
+        page[i] += 1;
+    }
+
+    // swap-remove the dead, walking backwards so the particle moved into slot i has already been checked
+    for(int i = n - 1; i >= 0; i--) {
+        if(age[i] >= lifetime[i]) {
+            removeAt(i);
+        }
+    }
+}
+
+void ParticleSystem::splat(const LatticeMap& map, float* accR, float* accG, float* accB) const {
+    for(int i = 0; i < n; i++) {
+        int cx, cy;
+        map.toLattice(x[i], y[i], &cx, &cy);
+        int panel = map.cellPanel[cy * map.size + cx];
+        if(panel < 0) {
+            continue;
+        }
+        float fade = 1 - age[i] / lifetime[i];
+        accR[panel] += R[i] * fade;
+        accG[panel] += G[i] * fade;
+        accB[panel] += B[i] * fade;
+    }
+}
@@ -0,0 +1,33 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+CPP_SRCS += \
+../src/AuroraPlugin.cpp \
+../src/GrayScott.cpp \
+../src/LatticeMap.cpp \
+../src/PanelGeometry.cpp 
+
+OBJS += \
+./src/AuroraPlugin.o \
+./src/GrayScott.o \
+./src/LatticeMap.o \
+./src/PanelGeometry.o 
+
+CPP_DEPS += \
+./src/AuroraPlugin.d \
+./src/GrayScott.d \
+./src/LatticeMap.d \
+./src/PanelGeometry.d 
+
+
+# Each subdirectory must supply rules for building sources it contributes
+src/%.o: ../src/%.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -I../inc -O0 -g3 -Wall -c -fmessage-length=0 -std=c++11 -fPIC -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+
@@ -0,0 +1,68 @@
+/*
+ * GrayScott.h
+ *
+ *  Description:
+ *  Gray-Scott reaction-diffusion on a square lattice. Two chemicals U and V diffuse and react:
+ *
+ *      U' = U + Du * lap(U) - U*V*V + feed * (1 - U)
+ *      V' = V + Dv * lap(V) + U*V*V - (feed + kill) * V
+ *
+ *  with lap() the 5-point stencil (sum of the 4 neighbours minus 4 times the centre). The lattice wraps
+ *  around at the edges. U and V each have two float planes that are swapped after every step. The interior
+ *  of every row is a plain loop over restrict pointers into the row above, the row itself and the row below,
+ *  which the compiler turns into SIMD code; the two edge columns are done separately.
+ *
+ *  Steps can be spread over several threads, each thread owning a band of rows and meeting the others at a
+ *  barrier after every step.
+ */
+
+#ifndef INC_GRAYSCOTT_H_
+#define INC_GRAYSCOTT_H_
+
+#include <vector>
+
+#define GRAYSCOTT_DU 0.16f    // diffusion rate of U
+#define GRAYSCOTT_DV 0.08f    // diffusion rate of V
+#define GRAYSCOTT_V_FLOOR 1e-12f // V decaying below this is set to 0, otherwise empty areas slowly sink into
+                                 // denormal floats, which are many times slower to compute with
+
+class GrayScott {
+public:
+    GrayScott();
+
+    /**
+     * @description: allocate a size x size lattice filled with U = 1, V = 0
+     */
+    void init(int size);
+
+    /**
+     * @description: drop a square of V into the lattice, this is what starts (or restarts) the patterns
+     * @param x, y: centre of the square, which wraps around the edges of the lattice
+     * @param radius: half the side length of the square
+     */
+    void seed(int x, int y, int radius);
+
+    /**
+     * @description: advance the simulation
+     * @param steps: number of steps to take
+     * @param feed: feed rate of U
+     * @param kill: kill rate of V
+     * @param nThreads: number of threads to spread the rows over, 1 runs on the calling thread
+     */
+    void step(int steps, float feed, float kill, int nThreads);
+
+    int size() const { return n; }
+    const float* v() const { return &V[0]; }   // the current V plane, size * size values row by row
+
+private:
+    void stepRows(int rowBegin, int rowEnd, float feed, float kill);
+    void stepCell(int x, int left, int right, const float* u, const float* vv,
+                  const float* uUp, const float* vUp, const float* uDown, const float* vDown,
+                  float* uOut, float* vOut, float feed, float kill);
+
+    int n;
+    std::vector<float> U, V;            // current planes
+    std::vector<float> nextU, nextV;    // planes being written during a step
+};
+
+#endif /* INC_GRAYSCOTT_H_ */
@@ -0,0 +1,51 @@
+/*
+ * LatticeMap.h
+ *
+ *  Description:
+ *  Maps the cells of a square lattice laid behind the layout onto the panels. The lattice is stretched over
+ *  the bounding box of all the panels; every cell whose centre lies inside a panel belongs to that panel.
+ *  Where cells are under more than one panel the first panel in the layout gets them. The map is worked
+ *  out once by PanelGeometry, without going through the Shape virtuals; after that reducing a lattice plane
+ *  to one value per panel is a single pass over the map.
+ */
+
+#ifndef INC_LATTICEMAP_H_
+#define INC_LATTICEMAP_H_
+
+#include "LayoutProcessingUtils.h"
+#include "PanelGeometry.h"
+#include <vector>
+
+class LatticeMap {
+public:
+    LatticeMap();
+
+    /**
+     * @description: work out which panel each lattice cell lies in
+     * @param layoutData: the layout to map onto
+     * @param size: the lattice is size x size cells
+     */
+    void build(LayoutData* layoutData, int size);
+
+    /**
+     * @description: average a lattice plane over each panel
+     * @param plane: size * size values, row by row
+     * @param out: one value per panel, in layoutData->panels order. Panels without a cell get 0
+     */
+    void average(const float* plane, float* out) const;
+
+    /** @description: lattice coordinates of the cell under a point in layout coordinates */
+    void toLattice(float x, float y, int* cx, int* cy) const;
+
+    int size;
+    int nPanels;
+    std::vector<int> cellPanel;     // the panel of each cell, -1 for cells between or around the panels
+    std::vector<int> panelCells;    // number of cells in each panel
+    PanelGeometry geometry;         // the panel shapes the map was built from
+
+private:
+    float originX, originY;  // layout coordinates of the lattice's corner
+    float cellSize;          // size of one cell in layout coordinates
+};
+
+#endif /* INC_LATTICEMAP_H_ */
@@ -0,0 +1,218 @@
+/**
+    Copyright 2017 Nanoleaf Ltd.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http:www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+    AuroraPlugin.cpp
+
+    Description:
+    Gray-Scott reaction-diffusion running on a fine lattice laid behind the panels. Two simulated chemicals
+    eat each other and spread out, which grows slowly moving spots, stripes and coral like patterns. Each
+    panel shows the average amount of the second chemical under it, coloured along the palette. Meant for
+    ambient installs: as a rhythm plugin the energy of the music shifts the feed and kill rates (and so the
+    kind of pattern) and loud moments seed new growth; as an effects plugin it simply runs on its own.
+ */
+
+
+#include "AuroraPlugin.h"
+#include "LayoutProcessingUtils.h"
+#include "ColorUtils.h"
+#include "DataManager.h"
+#include <stdlib.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "Logger.h"
+#include "PluginFeatures.h"
+#include "GrayScott.h"
+#include "LatticeMap.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    void initPlugin();
+    void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime);
+    void pluginCleanup();
+
+#ifdef __cplusplus
+}
+#endif
+
+#define TRANSITION_TIME 1  // the transition time to send to panels; set to 100ms currently
+#define SLEEP_TIME 1 // when running as an effects plugin, ask to be called again after 100ms
+//Lattice consts
+#define RD_LATTICE_SIZE 512 //the lattice is RD_LATTICE_SIZE x RD_LATTICE_SIZE cells over the whole layout
+#define RD_STEPS_PER_FRAME 8 //simulation steps per frame, sets how fast the patterns grow
+#define RD_THREADS 1 //number of threads the simulation is spread over
+#define RD_INITIAL_SEEDS 12 //number of squares of V dropped in at the start
+#define RD_SEED_RADIUS 4 //half the side of a seeded square, in cells
+#define RD_V_SCALE 0.35 //amount of V that maps to the last palette colour
+//Feed and kill consts
+#define RD_FEED 0.037 //feed rate in silence
+#define RD_KILL 0.06 //kill rate in silence
+#define RD_FEED_SWING 0.015 //feed rate added at full energy
+#define RD_KILL_SWING 0.004 //kill rate taken off at full energy
+#define ENERGY_DECAY 0.995 //how fast the remembered maximum energy falls back
+#define SEED_THRESHOLD 0.9 //energy (relative to the remembered maximum) that seeds new growth
+#define SEED_COOLDOWN 20 //frames between seeds
+
+static RGB_t* paletteColours = NULL; // this is our saved pointer to the colour palette
+static int nColours = 0;             // the number of colours in the palette
+static LayoutData *layoutData; // this is our saved pointer to the panel layout information
+static GrayScott reaction; // the simulation
+static LatticeMap latticeMap; // which lattice cells are under which panel
+static float* panelV = NULL; // average V under each panel
+static float maxEnergy = 1; // running maximum of the energy, used to normalize it
+static int framesSinceSeed = 0;
+
+/**
+ * @description: drop some V under a random panel
+ */
+void seedUnderRandomPanel() {
+    if(layoutData->nPanels < 1) {
+        return;
+    }
+    int n1 = drand48() * layoutData->nPanels;
+    int cx, cy;
+    latticeMap.toLattice(layoutData->panels[n1].shape->getCentroid().x, layoutData->panels[n1].shape->getCentroid().y, &cx, &cy);
+    reaction.seed(cx, cy, RD_SEED_RADIUS);
+}
+
+/**
+ * @description: Initialize the plugin. Called once, when the plugin is loaded.
+ * This function can be used to enable rhythm or advanced features,
+ * e.g., to enable energy feature, simply call enableEnergy()
+ * It can also be used to load the LayoutData and the colorPalette from the DataManager.
+ * Any allocation, if done here, should be deallocated in the plugin cleanup function
+ *
+ */
+void initPlugin() {
+    getColorPalette(&paletteColours, &nColours);  // grab the palette colours and store a pointer to them for later use
+    layoutData = getLayoutData(); // grab the layout data and store a pointer to it for later use
+
+    PRINTLOG("The layout has %d panels:\n", layoutData->nPanels);
+    for (int i = 0; i < layoutData->nPanels; i++) {
+        PRINTLOG("   Id: %d   X, Y: %lf, %lf\n", layoutData->panels[i].panelId,
+               layoutData->panels[i].shape->getCentroid().x, layoutData->panels[i].shape->getCentroid().y);
+    }
+
+    reaction.init(RD_LATTICE_SIZE);
+    latticeMap.build(layoutData, RD_LATTICE_SIZE);
+    panelV = new float[layoutData->nPanels];
+    for(int i = 0; i < RD_INITIAL_SEEDS; i++) {
+        seedUnderRandomPanel();
+    }
+    enableEnergy();
+}
+
+/**
+ * @description: colour for an amount of V, running along the palette from the first colour to the last
+ */
+RGB_t colourForV(float v) {
+    RGB_t color = {0, 0, 0};
+    float t = v / RD_V_SCALE;
+    if(t > 1) {
+        t = 1;
+    }
+    if(nColours == 0) {
+        color.R = color.G = color.B = t * 255;
+        return color;
+    }
+    float pos = t * (nColours - 1);
+    int i = (int)pos;
+    int j = i + 1 < nColours ? i + 1 : i;
+    float f = pos - i;
+    // fade in from black so empty areas stay dark
+    color.R = (paletteColours[i].R * (1 - f) + paletteColours[j].R * f) * t;
+    color.G = (paletteColours[i].G * (1 - f) + paletteColours[j].G * f) * t;
+    color.B = (paletteColours[i].B * (1 - f) + paletteColours[j].B * f) * t;
+    return color;
+}
+
+/**
+ * @description: this the 'main' function that gives a frame to the Aurora to display onto the panels
+ * To obtain updated values of enabled features, simply call get<feature_name>, e.g.,
+ * getEnergy(), getIsBeat().
+ *
+ * If the plugin is a sound visualization plugin, the sleepTime variable will be NULL and is not required to be
+ * filled in
+ * This function, if is an effects plugin, can specify the interval it is to be called at through the sleepTime variable
+ * if its a sound visualization plugin, this function is called at an interval of 50ms or more.
+ *
+ * @param frames: a pre-allocated buffer of the Frame_t structure to fill up with RGB values to show on panels.
+ * Maximum size of this buffer is equal to the number of panels
+ * @param nFrames: fill with the number of frames in frames
+ * @param sleepTime: specify interval after which this function is called again, NULL if sound visualization plugin
+ */
+void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime) {
+    float feed = RD_FEED;
+    float kill = RD_KILL;
+
+    if(sleepTime != NULL) {
+        // effects plugin, there is no sound to listen to
+        *sleepTime = SLEEP_TIME;
+    } else {
+        float energy = getEnergy();
+        maxEnergy = maxEnergy * ENERGY_DECAY;
+        if(energy > maxEnergy) {
+            maxEnergy = energy;
+        }
+        float level = energy / maxEnergy;
+        feed += RD_FEED_SWING * level;
+        kill -= RD_KILL_SWING * level;
+
+        framesSinceSeed++;
+        if(level > SEED_THRESHOLD && framesSinceSeed > SEED_COOLDOWN) {
+            seedUnderRandomPanel();
+            framesSinceSeed = 0;
+        }
+    }
+
+    reaction.step(RD_STEPS_PER_FRAME, feed, kill, RD_THREADS);
+    latticeMap.average(reaction.v(), panelV);
+
+    bool alive = false;
+    for(int i = 0; i < layoutData->nPanels; i++) {
+        RGB_t color = colourForV(panelV[i]);
+        frames[i].panelId = layoutData->panels[i].panelId;
+        frames[i].r = color.R;
+        frames[i].g = color.G;
+        frames[i].b = color.B;
+        frames[i].transTime = TRANSITION_TIME;
+        alive = alive || panelV[i] > 0.01;
+    }
+    // the pattern can starve itself to death, start it up again
+    if(!alive) {
+        seedUnderRandomPanel();
+    }
+    *nFrames = layoutData->nPanels;
+}
+
+/**
+ * @description: called once when the plugin is being closed.
+ * Do all deallocation for memory allocated in initplugin here
+ */
+void pluginCleanup() {
+    delete [] panelV;
+    panelV = NULL;
+    // the four 512 x 512 planes are most of the plugin's memory, hand them back
+    reaction = GrayScott();
+    latticeMap = LatticeMap();
+    maxEnergy = 1;
+    framesSinceSeed = 0;
+    layoutData = NULL;
+    paletteColours = NULL;
+    nColours = 0;
+}
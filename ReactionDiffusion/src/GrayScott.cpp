@@ -0,0 +1,145 @@
+/*
+ * GrayScott.cpp
+ *
+ *  Description:
+ *  Gray-Scott reaction-diffusion, see GrayScott.h.
+ */
+
+#include "GrayScott.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/** Reusable barrier, every thread waits until all of them have arrived */
+class StepBarrier {
+public:
+    StepBarrier(int count) : count(count), waiting(0), generation(0) {}
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        int gen = generation;
+        if(++waiting == count) {
+            waiting = 0;
+            generation++;
+            cv.notify_all();
+        } else {
+            cv.wait(lock, [this, gen] { return gen != generation; });
+        }
+    }
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    int count;
+    int waiting;
+    int generation;
+};
+
+GrayScott::GrayScott() {
+    n = 0;
+}
+
+void GrayScott::init(int size) {
+    n = size;
+    U.assign(n * n, 1.0);
+    V.assign(n * n, 0.0);
+    nextU.assign(n * n, 1.0);
+    nextV.assign(n * n, 0.0);
+}
+
+void GrayScott::seed(int x, int y, int radius) {
+    for(int j = y - radius; j < y + radius; j++) {
+        for(int i = x - radius; i < x + radius; i++) {
+            int idx = ((j % n + n) % n) * n + ((i % n + n) % n);
+            U[idx] = 0.5;
+            V[idx] = 0.25;
+        }
+    }
+}
+
+inline void GrayScott::stepCell(int x, int left, int right, const float* u, const float* vv,
+                                const float* uUp, const float* vUp, const float* uDown, const float* vDown,
+                                float* uOut, float* vOut, float feed, float kill) {
+    float lapU = uUp[x] + uDown[x] + u[left] + u[right] - 4 * u[x];
+    float lapV = vUp[x] + vDown[x] + vv[left] + vv[right] - 4 * vv[x];
+    float uvv = u[x] * vv[x] * vv[x];
+    uOut[x] = u[x] + GRAYSCOTT_DU * lapU - uvv + feed * (1 - u[x]);
+    float v = vv[x] + GRAYSCOTT_DV * lapV + uvv - (feed + kill) * vv[x];
+    vOut[x] = v < GRAYSCOTT_V_FLOOR ? 0 : v;
+}
+
+/**
+ * @description: one step for the cells 1 .. n-2 of a row. These have no wrap around, so the loop is kept
+ * free of branches and aliasing for the compiler to vectorize it.
+ */
+static void stepInterior(int n, const float* __restrict__ u, const float* __restrict__ vv,
+                         const float* __restrict__ uUp, const float* __restrict__ vUp,
+                         const float* __restrict__ uDown, const float* __restrict__ vDown,
+                         float* __restrict__ uOut, float* __restrict__ vOut, float feed, float kill) {
+    for(int x = 1; x < n - 1; x++) {
+        float lapU = uUp[x] + uDown[x] + u[x - 1] + u[x + 1] - 4 * u[x];
+        float lapV = vUp[x] + vDown[x] + vv[x - 1] + vv[x + 1] - 4 * vv[x];
+        float uvv = u[x] * vv[x] * vv[x];
+        uOut[x] = u[x] + GRAYSCOTT_DU * lapU - uvv + feed * (1 - u[x]);
+        float v = vv[x] + GRAYSCOTT_DV * lapV + uvv - (feed + kill) * vv[x];
+        vOut[x] = v < GRAYSCOTT_V_FLOOR ? 0 : v;
+    }
+}
+
+void GrayScott::stepRows(int rowBegin, int rowEnd, float feed, float kill) {
+    for(int row = rowBegin; row < rowEnd; row++) {
+        int up = row == 0 ? n - 1 : row - 1;
+        int down = row == n - 1 ? 0 : row + 1;
+        const float* u = &U[row * n];
+        const float* vv = &V[row * n];
+        const float* uUp = &U[up * n];
+        const float* vUp = &V[up * n];
+        const float* uDown = &U[down * n];
+        const float* vDown = &V[down * n];
+        float* uOut = &nextU[row * n];
+        float* vOut = &nextV[row * n];
+
+        stepCell(0, n - 1, 1, u, vv, uUp, vUp, uDown, vDown, uOut, vOut, feed, kill);
+        stepInterior(n, u, vv, uUp, vUp, uDown, vDown, uOut, vOut, feed, kill);
+        stepCell(n - 1, n - 2, 0, u, vv, uUp, vUp, uDown, vDown, uOut, vOut, feed, kill);
+    }
+}
+
+void GrayScott::step(int steps, float feed, float kill, int nThreads) {
+    if(n < 2) {
+        return;
+    }
+    nThreads = std::max(1, std::min(nThreads, n));
+    if(nThreads == 1) {
+        for(int s = 0; s < steps; s++) {
+            stepRows(0, n, feed, kill);
+            U.swap(nextU);
+            V.swap(nextV);
+        }
+        return;
+    }
+
+    // every thread owns a band of rows; after each step they meet so the last one in can swap the planes
+    StepBarrier computed(nThreads);
+    StepBarrier swapped(nThreads);
+    auto worker = [&](int t) {
+        int rowBegin = n * t / nThreads;
+        int rowEnd = n * (t + 1) / nThreads;
+        for(int s = 0; s < steps; s++) {
+            stepRows(rowBegin, rowEnd, feed, kill);
+            computed.wait();
+            if(t == 0) {
+                U.swap(nextU);
+                V.swap(nextV);
+            }
+            swapped.wait();
+        }
+    };
+    std::vector<std::thread> threads;
+    for(int t = 1; t < nThreads; t++) {
+        threads.push_back(std::thread(worker, t));
+    }
+    worker(0);
+    for(size_t t = 0; t < threads.size(); t++) {
+        threads[t].join();
+    }
+}
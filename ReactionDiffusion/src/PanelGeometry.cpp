@@ -0,0 +1,345 @@
+/*
+ * PanelGeometry.cpp
+ *
+ *  Description:
+ *  Shape specialized panel geometry, see PanelGeometry.h.
+ */
+
+#include "PanelGeometry.h"
+#include <algorithm>
+#include <math.h>
+
+// ---- per shape setup, point test and corners, picked by overloading ----
+
+static void makeShape(const Shape* shape, triangle_t* t) {
+    for(int k = 0; k < 3; k++) {
+        t->cx[k] = shape->vertices[k].x;
+        t->cy[k] = shape->vertices[k].y;
+    }
+    t->ax = t->cx[0];
+    t->ay = t->cy[0];
+    t->v0x = t->cx[2] - t->ax;
+    t->v0y = t->cy[2] - t->ay;
+    t->v1x = t->cx[1] - t->ax;
+    t->v1y = t->cy[1] - t->ay;
+    t->d00 = t->v0x * t->v0x + t->v0y * t->v0y;
+    t->d01 = t->v0x * t->v1x + t->v0y * t->v1y;
+    t->d11 = t->v1x * t->v1x + t->v1y * t->v1y;
+    float denom = t->d00 * t->d11 - t->d01 * t->d01;
+    t->invDenom = denom != 0 ? 1 / denom : 0;
+}
+
+static inline bool contains(const triangle_t& t, float x, float y) {
+    float v2x = x - t.ax;
+    float v2y = y - t.ay;
+    float d02 = t.v0x * v2x + t.v0y * v2y;
+    float d12 = t.v1x * v2x + t.v1y * v2y;
+    float u = (t.d11 * d02 - t.d01 * d12) * t.invDenom;
+    float v = (t.d00 * d12 - t.d01 * d02) * t.invDenom;
+    return u >= 0 && v >= 0 && u + v <= 1;
+}
+
+static int corners(const triangle_t& t, float* x, float* y) {
+    for(int k = 0; k < 3; k++) {
+        x[k] = t.cx[k];
+        y[k] = t.cy[k];
+    }
+    return 3;
+}
+
+static void makeShape(const Shape* shape, square_t* s) {
+    s->cx = s->cy = 0;
+    for(int k = 0; k < 4; k++) {
+        s->cx += shape->vertices[k].x / 4;
+        s->cy += shape->vertices[k].y / 4;
+    }
+    float sx = shape->vertices[1].x - shape->vertices[0].x;
+    float sy = shape->vertices[1].y - shape->vertices[0].y;
+    float side = sqrtf(sx * sx + sy * sy);
+    s->ux = side > 0 ? sx / side : 1;
+    s->uy = side > 0 ? sy / side : 0;
+    s->half = side / 2;
+}
+
+static inline bool contains(const square_t& s, float x, float y) {
+    float dx = x - s.cx;
+    float dy = y - s.cy;
+    float along = dx * s.ux + dy * s.uy;
+    float across = dy * s.ux - dx * s.uy;
+    return fabsf(along) <= s.half && fabsf(across) <= s.half;
+}
+
+static int corners(const square_t& s, float* x, float* y) {
+    const float signs[4][2] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+    for(int k = 0; k < 4; k++) {
+        float a = signs[k][0] * s.half;
+        float b = signs[k][1] * s.half;
+        x[k] = s.cx + a * s.ux - b * s.uy;
+        y[k] = s.cy + a * s.uy + b * s.ux;
+    }
+    return 4;
+}
+
+static void makeShape(const Shape* shape, polygon_t* p) {
+    p->n = std::min(shape->nVertices, GEOMETRY_MAX_VERTICES);
+    float area = 0;
+    for(int k = 0; k < p->n; k++) {
+        p->x[k] = shape->vertices[k].x;
+        p->y[k] = shape->vertices[k].y;
+    }
+    for(int k = 0; k < p->n; k++) {
+        int next = (k + 1) % p->n;
+        area += p->x[k] * p->y[next] - p->x[next] * p->y[k];
+    }
+    p->sign = area >= 0 ? 1 : -1;
+}
+
+static inline bool contains(const polygon_t& p, float x, float y) {
+    for(int k = 0; k < p.n; k++) {
+        int next = k + 1 < p.n ? k + 1 : 0;
+        float cross = (p.x[next] - p.x[k]) * (y - p.y[k]) - (p.y[next] - p.y[k]) * (x - p.x[k]);
+        if(cross * p.sign < 0) {
+            return false;
+        }
+    }
+    return p.n >= 3;
+}
+
+static int corners(const polygon_t& p, float* x, float* y) {
+    for(int k = 0; k < p.n; k++) {
+        x[k] = p.x[k];
+        y[k] = p.y[k];
+    }
+    return p.n;
+}
+
+// ---- operations, one instantiation per bucket ----
+
+template<class T>
+static void addPanel(geometry_bucket_t<T>* bucket, const Shape* shape, int panel) {
+    T t;
+    makeShape(shape, &t);
+    float x[GEOMETRY_MAX_VERTICES], y[GEOMETRY_MAX_VERTICES];
+    int n = corners(t, x, y);
+    geometry_box_t box = {0, 0, 0, 0};
+    for(int k = 0; k < n; k++) {
+        if(k == 0) {
+            box.minX = box.maxX = x[0];
+            box.minY = box.maxY = y[0];
+        }
+        box.minX = std::min(box.minX, x[k]);
+        box.maxX = std::max(box.maxX, x[k]);
+        box.minY = std::min(box.minY, y[k]);
+        box.maxY = std::max(box.maxY, y[k]);
+    }
+    bucket->shapes.push_back(t);
+    bucket->boxes.push_back(box);
+    bucket->panel.push_back(panel);
+}
+
+template<class T>
+static void clearBucket(geometry_bucket_t<T>* bucket) {
+    bucket->shapes.clear();
+    bucket->boxes.clear();
+    bucket->panel.clear();
+}
+
+template<class T>
+static void growBox(const geometry_bucket_t<T>& bucket, geometry_box_t* box, bool* empty) {
+    for(size_t k = 0; k < bucket.boxes.size(); k++) {
+        const geometry_box_t& b = bucket.boxes[k];
+        if(*empty) {
+            *box = b;
+            *empty = false;
+        }
+        box->minX = std::min(box->minX, b.minX);
+        box->maxX = std::max(box->maxX, b.maxX);
+        box->minY = std::min(box->minY, b.minY);
+        box->maxY = std::max(box->maxY, b.maxY);
+    }
+}
+
+template<class T>
+static void panelAtBucket(const geometry_bucket_t<T>& bucket, float x, float y, int* found) {
+    for(size_t k = 0; k < bucket.shapes.size(); k++) {
+        const geometry_box_t& b = bucket.boxes[k];
+        if(x < b.minX || x > b.maxX || y < b.minY || y > b.maxY) {
+            continue;
+        }
+        if((*found < 0 || bucket.panel[k] < *found) && contains(bucket.shapes[k], x, y)) {
+            *found = bucket.panel[k];
+        }
+    }
+}
+
+/** lattice cell under a coordinate, clamped to the lattice */
+static inline int toCell(float value, float origin, float cellSize, int size) {
+    return std::min(std::max((int)((value - origin) / cellSize), 0), size - 1);
+}
+
+template<class T>
+static void rasterizeBucket(const geometry_bucket_t<T>& bucket, float originX, float originY, float cellSize, int size,
+                            int* cellPanel, int* panelCells) {
+    for(size_t k = 0; k < bucket.shapes.size(); k++) {
+        // only the cells under the panel's own bounding box need to be tested against it
+        const T& shape = bucket.shapes[k];
+        const geometry_box_t& b = bucket.boxes[k];
+        int panel = bucket.panel[k];
+        int x0 = toCell(b.minX, originX, cellSize, size);
+        int x1 = toCell(b.maxX, originX, cellSize, size);
+        int y0 = toCell(b.minY, originY, cellSize, size);
+        int y1 = toCell(b.maxY, originY, cellSize, size);
+        for(int cy = y0; cy <= y1; cy++) {
+            float y = originY + (cy + 0.5f) * cellSize;
+            for(int cx = x0; cx <= x1; cx++) {
+                int& owner = cellPanel[cy * size + cx];
+                if(owner >= 0 && owner < panel) {
+                    continue;
+                }
+                if(contains(shape, originX + (cx + 0.5f) * cellSize, y)) {
+                    if(owner >= 0) {
+                        panelCells[owner]--;
+                    }
+                    owner = panel;
+                    panelCells[panel]++;
+                }
+            }
+        }
+    }
+}
+
+typedef struct {
+    float x, y;     // midpoint
+    float length;
+    int panel;
+} geometry_edge_t;
+
+template<class T>
+static void collectEdges(const geometry_bucket_t<T>& bucket, std::vector<geometry_edge_t>* edges) {
+    float x[GEOMETRY_MAX_VERTICES], y[GEOMETRY_MAX_VERTICES];
+    for(size_t k = 0; k < bucket.shapes.size(); k++) {
+        int n = corners(bucket.shapes[k], x, y);
+        for(int c = 0; c < n; c++) {
+            int next = (c + 1) % n;
+            geometry_edge_t edge;
+            edge.x = (x[c] + x[next]) / 2;
+            edge.y = (y[c] + y[next]) / 2;
+            edge.length = sqrtf((x[next] - x[c]) * (x[next] - x[c]) + (y[next] - y[c]) * (y[next] - y[c]));
+            edge.panel = bucket.panel[k];
+            edges->push_back(edge);
+        }
+    }
+}
+
+// ---- PanelGeometry ----
+
+PanelGeometry::PanelGeometry() {
+    nPanels = 0;
+    layoutBox.minX = layoutBox.minY = layoutBox.maxX = layoutBox.maxY = 0;
+}
+
+void PanelGeometry::build(LayoutData* layoutData) {
+    nPanels = layoutData->nPanels;
+    clearBucket(&triangles);
+    clearBucket(&squares);
+    clearBucket(&polygons);
+    for(int i = 0; i < nPanels; i++) {
+        const Shape* shape = layoutData->panels[i].shape;
+        if(shape->shapeType == SHAPE_TRIANGLE && shape->nVertices == 3) {
+            addPanel(&triangles, shape, i);
+        } else if(shape->shapeType == SHAPE_SQUARE && shape->nVertices == 4) {
+            addPanel(&squares, shape, i);
+        } else {
+            addPanel(&polygons, shape, i);
+        }
+    }
+    bool empty = true;
+    growBox(triangles, &layoutBox, &empty);
+    growBox(squares, &layoutBox, &empty);
+    growBox(polygons, &layoutBox, &empty);
+}
+
+int PanelGeometry::panelAt(float x, float y) const {
+    int found = -1;
+    panelAtBucket(triangles, x, y, &found);
+    panelAtBucket(squares, x, y, &found);
+    panelAtBucket(polygons, x, y, &found);
+    return found;
+}
+
+void PanelGeometry::rasterize(float originX, float originY, float cellSize, int size,
+                              std::vector<int>* cellPanel, std::vector<int>* panelCells) const {
+    if(size <= 0 || nPanels == 0) {
+        return;
+    }
+    rasterizeBucket(triangles, originX, originY, cellSize, size, &(*cellPanel)[0], &(*panelCells)[0]);
+    rasterizeBucket(squares, originX, originY, cellSize, size, &(*cellPanel)[0], &(*panelCells)[0]);
+    rasterizeBucket(polygons, originX, originY, cellSize, size, &(*cellPanel)[0], &(*panelCells)[0]);
+}
+
+void PanelGeometry::adjacency(std::vector<std::vector<int> >* neighbours) const {
+    neighbours->assign(nPanels, std::vector<int>());
+    std::vector<geometry_edge_t> edges;
+    collectEdges(triangles, &edges);
+    collectEdges(squares, &edges);
+    collectEdges(polygons, &edges);
+    if(edges.empty()) {
+        return;
+    }
+
+    // bucket the edge midpoints into a grid of cells as big as the longest edge, shared edges have (almost)
+    // the same midpoint so only the 3x3 cells around an edge need searching
+    float cell = 0;
+    float minX = edges[0].x, minY = edges[0].y, maxX = minX, maxY = minY;
+    for(size_t e = 0; e < edges.size(); e++) {
+        cell = std::max(cell, edges[e].length);
+        minX = std::min(minX, edges[e].x);
+        maxX = std::max(maxX, edges[e].x);
+        minY = std::min(minY, edges[e].y);
+        maxY = std::max(maxY, edges[e].y);
+    }
+    if(cell <= 0) {
+        return;
+    }
+    int gridW = (int)((maxX - minX) / cell) + 1;
+    int gridH = (int)((maxY - minY) / cell) + 1;
+    std::vector<int> cellStart(gridW * gridH + 1, 0);
+    std::vector<int> cellOf(edges.size());
+    for(size_t e = 0; e < edges.size(); e++) {
+        cellOf[e] = (int)((edges[e].y - minY) / cell) * gridW + (int)((edges[e].x - minX) / cell);
+        cellStart[cellOf[e] + 1]++;
+    }
+    for(int c = 0; c < gridW * gridH; c++) {
+        cellStart[c + 1] += cellStart[c];
+    }
+    std::vector<int> cellEdges(edges.size());
+    std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+    for(size_t e = 0; e < edges.size(); e++) {
+        cellEdges[fill[cellOf[e]]++] = e;
+    }
+
+    for(size_t e = 0; e < edges.size(); e++) {
+        const geometry_edge_t& a = edges[e];
+        int cx = cellOf[e] % gridW;
+        int cy = cellOf[e] / gridW;
+        for(int y = std::max(cy - 1, 0); y <= std::min(cy + 1, gridH - 1); y++) {
+            for(int x = std::max(cx - 1, 0); x <= std::min(cx + 1, gridW - 1); x++) {
+                int c = y * gridW + x;
+                for(int k = cellStart[c]; k < cellStart[c + 1]; k++) {
+                    const geometry_edge_t& b = edges[cellEdges[k]];
+                    float tolerance = EDGE_TOLERANCE * std::min(a.length, b.length);
+                    float dx = a.x - b.x;
+                    float dy = a.y - b.y;
+                    if(b.panel != a.panel && dx * dx + dy * dy <= tolerance * tolerance) {
+                        (*neighbours)[a.panel].push_back(b.panel);
+                    }
+                }
+            }
+        }
+    }
+    for(int i = 0; i < nPanels; i++) {
+        std::vector<int>& list = (*neighbours)[i];
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+}
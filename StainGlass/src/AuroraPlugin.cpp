@@ -99,5 +99,9 @@ void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime){
  * Do all deallocation for memory allocated in initplugin here
  */
 void pluginCleanup(){
-	//do deallocation here
+	delete [] frameColors;
+	frameColors = NULL;
+	layoutData = NULL;
+	palettenColors = NULL;
+	nColors = 0;
 }
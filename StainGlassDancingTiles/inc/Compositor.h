@@ -0,0 +1,128 @@
+/*
+ * Compositor.h
+ *
+ *  Description:
+ *  Stacks several effect layers onto the panels in a single pass. Each layer is a small class with a
+ *
+ *      bool sample(int panel, layer_sample_t* out)
+ *
+ *  member that returns the layer's colour and opacity for one panel (or false if it has nothing there),
+ *  wrapped in a Layer<blend mode, ...> that says how it combines with the layers below it. composite() then
+ *  walks the panels once and runs every layer, bottom to top, on each panel's accumulator. The layers are
+ *  template parameters, so the whole stack is inlined into the one loop with no per layer render loop and
+ *  no virtual calls.
+ *
+ *  Blend modes, acc being the colour accumulated so far:
+ *      BLEND_OVER          acc = acc * (1 - A) + colour * A
+ *      BLEND_ADD           acc = acc + colour * A
+ *      BLEND_MULTIPLY      acc = acc * (1 - A + colour / 255 * A)
+ *      BLEND_VALUE_SCALE   acc = acc * A, i.e. the HSV value scaled by A (R, G, B of the sample are ignored)
+ */
+
+#ifndef INC_COMPOSITOR_H_
+#define INC_COMPOSITOR_H_
+
+typedef struct {
+    float R, G, B; // colour of the layer on this panel, 0 - 255
+    float A;       // opacity, or the scale for BLEND_VALUE_SCALE
+} layer_sample_t;
+
+enum BlendMode {
+    BLEND_OVER,
+    BLEND_ADD,
+    BLEND_MULTIPLY,
+    BLEND_VALUE_SCALE
+};
+
+/** A layer of the stack: the source of the samples and how they blend with what is below */
+template<BlendMode mode, class Source>
+struct Layer {
+    Source& source;
+    Layer(Source& s) : source(s) {}
+};
+
+/** Helper so the blend mode does not have to be repeated: makeLayer<BLEND_OVER>(base) */
+template<BlendMode mode, class Source>
+Layer<mode, Source> makeLayer(Source& source) {
+    return Layer<mode, Source>(source);
+}
+
+/** Blends one layer into the accumulator, specialised per blend mode */
+template<BlendMode mode>
+struct Blend;
+
+template<>
+struct Blend<BLEND_OVER> {
+    static inline void apply(const layer_sample_t& s, float* R, float* G, float* B) {
+        *R = *R * (1 - s.A) + s.R * s.A;
+        *G = *G * (1 - s.A) + s.G * s.A;
+        *B = *B * (1 - s.A) + s.B * s.A;
+    }
+};
+
+template<>
+struct Blend<BLEND_ADD> {
+    static inline void apply(const layer_sample_t& s, float* R, float* G, float* B) {
+        *R += s.R * s.A;
+        *G += s.G * s.A;
+        *B += s.B * s.A;
+    }
+};
+
+template<>
+struct Blend<BLEND_MULTIPLY> {
+    static inline void apply(const layer_sample_t& s, float* R, float* G, float* B) {
+        *R *= 1 - s.A + s.R * (1.0f / 255) * s.A;
+        *G *= 1 - s.A + s.G * (1.0f / 255) * s.A;
+        *B *= 1 - s.A + s.B * (1.0f / 255) * s.A;
+    }
+};
+
+template<>
+struct Blend<BLEND_VALUE_SCALE> {
+    static inline void apply(const layer_sample_t& s, float* R, float* G, float* B) {
+        // scaling all three channels by the same factor scales V and keeps H and S, no HSV round trip needed
+        *R *= s.A;
+        *G *= s.A;
+        *B *= s.A;
+    }
+};
+
+/** Runs one layer on one panel */
+template<BlendMode mode, class Source>
+inline void applyLayer(Layer<mode, Source>& layer, int panel, float* R, float* G, float* B) {
+    layer_sample_t s;
+    if(layer.source.sample(panel, &s)) {
+        Blend<mode>::apply(s, R, G, B);
+    }
+}
+
+inline void applyLayers(int panel, float* R, float* G, float* B) {
+}
+
+template<class First, class... Rest>
+inline void applyLayers(int panel, float* R, float* G, float* B, First& first, Rest&... rest) {
+    applyLayer(first, panel, R, G, B);
+    applyLayers(panel, R, G, B, rest...);
+}
+
+/**
+ * @description: composite the layers (first argument is the bottom layer) onto every panel
+ * @param nPanels: number of panels
+ * @param R, G, B: accumulators, nPanels values each. Every panel starts out black
+ * @param layers: the stack, bottom first
+ */
+template<class... Layers>
+void composite(int nPanels, float* R, float* G, float* B, Layers... layers) {
+    for(int i = 0; i < nPanels; i++) {
+        float r = 0;
+        float g = 0;
+        float b = 0;
+        applyLayers(i, &r, &g, &b, layers...);
+        R[i] = r;
+        G[i] = g;
+        B[i] = b;
+    }
+}
+
+#endif /* INC_COMPOSITOR_H_ */
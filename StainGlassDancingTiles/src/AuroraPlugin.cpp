@@ -22,6 +22,7 @@
     Beat Detection, FFT to light source color and Panel Color calculations based on FrequncyStars by Nathan Dyck.
     Spawns a new light source at the center of a random pane when beat detected color based on fft.
     Increments age of sources every loop and removes a source either when array would be overflowed or age > lifespan.
+    The stain glass and the light sources are layers stacked by the Compositor.
 
  */
 
@@ -36,6 +37,7 @@
 #include <string.h>
 #include "Logger.h"
 #include "PluginFeatures.h"
+#include "Compositor.h"
 
 
 #ifdef __cplusplus
@@ -59,6 +61,7 @@ extern "C" {
 //Light source consts
 #define SPAWN_AMOUNT 1
 #define LIFESPAN 1 //the max number of cycles a source will live
+#define SOURCE_VALUE_SCALE 0.5 //panels with a source on them are shown at this brightness
 
 // Here we store the information accociated with each light source like current
 // position, velocity and colour. The information is stored in a list called sources.
@@ -66,6 +69,7 @@ typedef struct {
     float x;
     float y;
     int age;
+    int panel; // the panel the source sits on
 } source_t;
 
 /** Here we store the information accociated with each frequency bin. This
@@ -89,6 +93,11 @@ static source_t sources[MAX_SOURCES]; // this is our array for sources
 static int nSources = 0;
 static freq_bin freq_bins[MAX_PALETTE_nColors]; // this is our array for frequency bin historical information.
 static RGB_t* frameColors = NULL;
+static int* panelSources = NULL; // number of sources on each panel, refreshed every frame
+static float* panelR = NULL; // composited colour of each panel
+static float* panelG = NULL;
+static float* panelB = NULL;
+static int warmupFrames = 0; // frames skipped so far, see SKIP_COUNT
 
 /**
   * @description: add a value to a running max.
@@ -139,6 +148,10 @@ void initPlugin() {
   		int color = drand48() * nColors;
   		frameColors[i] = palettenColors[color];
   	}
+    panelSources = new int[layoutData->nPanels];
+    panelR = new float[layoutData->nPanels];
+    panelG = new float[layoutData->nPanels];
+    panelB = new float[layoutData->nPanels];
 
 
 
@@ -222,33 +235,35 @@ void addSource(int paletteIndex, float intensity)
     sources[nSources].x = x;
     sources[nSources].y = y;
     sources[nSources].age = 0;
+    sources[nSources].panel = n1;
     //sources[nSources].alive = true;
     nSources++;
   }
 }
 
-/**
-  * @description: This function will render the colour of the given single panel given
-  * the positions of all the lights in the light source list.
-  */
-RGB_t renderPanel(Panel *panel, RGB_t inputColor)
-{
-    // Iterate through all the sources
-    // Depending how close the source is to the panel, we take some fraction of its colour and mix it into an
-    // accumulator. Newest sources have the most weight. Old sources die away until they are gone.
-    for(int i = 0; i < nSources; i++) {
-        if(sources[i].x == panel->shape->getCentroid().x &&
-          sources[i].y == panel->shape->getCentroid().y) {
-          HSV_t value;
-        	RGBtoHSV(inputColor, &value);
-        	value.V *= .5;
-        	RGB_t ret;
-        	HSVtoRGB(value, &ret);
-        	return ret;
+/** Bottom layer: the stain glass, a fixed palette colour on every panel */
+class StainGlassLayer {
+public:
+    bool sample(int panel, layer_sample_t* out) {
+        out->R = frameColors[panel].R;
+        out->G = frameColors[panel].G;
+        out->B = frameColors[panel].B;
+        out->A = 1;
+        return true;
+    }
+};
+
+/** Top layer: a panel with a light source on it is darkened */
+class SourceLayer {
+public:
+    bool sample(int panel, layer_sample_t* out) {
+        if(panelSources[panel] == 0) {
+            return false;
         }
+        out->A = SOURCE_VALUE_SCALE;
+        return true;
     }
-    return inputColor;
-}
+};
 
 /**
   * A simple algorithm to detect beats. It finds a strong signal after a period of quietness.
@@ -304,9 +319,8 @@ void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime) {
     uint8_t * fftBins = getFftBins();
 
 #define SKIP_COUNT 50
-    static int cnt = 0;
-    if (cnt < SKIP_COUNT){
-        cnt++;
+    if (warmupFrames < SKIP_COUNT){
+        warmupFrames++;
         return;
     }
 
@@ -338,13 +352,23 @@ void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime) {
     }
 
 
-    // iterate through all the pals and render each one
+    // mark the panels that have a source on them
+    memset(panelSources, 0, sizeof(int) * layoutData->nPanels);
+    for(i = 0; i < nSources; i++) {
+        panelSources[sources[i].panel]++;
+    }
+
+    // stack the layers onto the panels in one pass, then hand the result to the panels
+    StainGlassLayer stainGlass;
+    SourceLayer lights;
+    composite(layoutData->nPanels, panelR, panelG, panelB,
+              makeLayer<BLEND_OVER>(stainGlass),
+              makeLayer<BLEND_VALUE_SCALE>(lights));
     for(i = 0; i < layoutData->nPanels; i++) {
-        RGB_t color = renderPanel(&layoutData->panels[i], frameColors[i]);
         frames[i].panelId = layoutData->panels[i].panelId;
-        frames[i].r = color.R;
-        frames[i].g = color.G;
-        frames[i].b = color.B;
+        frames[i].r = (int)panelR[i];
+        frames[i].g = (int)panelG[i];
+        frames[i].b = (int)panelB[i];
         frames[i].transTime = TRANSITION_TIME;
     }
 
@@ -365,5 +389,21 @@ void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime) {
  * Do all deallocation for memory allocated in initplugin here
  */
 void pluginCleanup() {
-    // do deallocation here, but there is nothing to deallocate
+    // do deallocation here
+    delete [] frameColors;
+    frameColors = NULL;
+    delete [] panelSources;
+    panelSources = NULL;
+    delete [] panelR;
+    panelR = NULL;
+    delete [] panelG;
+    panelG = NULL;
+    delete [] panelB;
+    panelB = NULL;
+    nSources = 0;
+    memset(freq_bins, 0, sizeof(freq_bins));
+    warmupFrames = 0;
+    layoutData = NULL;
+    palettenColors = NULL;
+    nColors = 0;
 }
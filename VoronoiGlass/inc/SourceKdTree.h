@@ -0,0 +1,72 @@
+/*
+ * SourceKdTree.h
+ *
+ *  Description:
+ *  Small incremental 2d kd-tree over the live light sources, used to find the source nearest to a panel.
+ *  Sources are inserted as they are spawned and removed (lazily, by marking them dead) when they expire.
+ *  The tree is rebuilt balanced from the live sources once too many dead nodes pile up or inserts have made
+ *  it too deep. Queries can be warm-started from a hint, usually the source that owned the panel in the
+ *  previous frame, which bounds the search to a small neighbourhood straight away.
+ */
+
+#ifndef INC_SOURCEKDTREE_H_
+#define INC_SOURCEKDTREE_H_
+
+#include <vector>
+
+class SourceKdTree {
+public:
+    /**
+     * @param maxIds: source ids handed to the tree must be in the range [0, maxIds)
+     */
+    SourceKdTree(int maxIds);
+
+    /** @description: remove all sources */
+    void clear();
+
+    /**
+     * @description: add a source to the tree
+     * @param x, y: position of the source
+     * @param id: the id of the source, reported back by nearest()
+     */
+    void insert(float x, float y, int id);
+
+    /** @description: remove the source with the given id from the tree */
+    void remove(int id);
+
+    /**
+     * @description: find the live source nearest to the point (x, y)
+     * @param hint: id of a source that is probably close to the point (e.g. last frame's answer) or -1
+     * @return: the id of the nearest source, -1 if the tree holds no live sources
+     */
+    int nearest(float x, float y, int hint) const;
+
+    /**
+     * @description: rebuild the tree balanced if removals or unlucky inserts have degraded it.
+     * Cheap to call every frame, it only does work when needed.
+     */
+    void maintain();
+
+    int size() const { return nLive; }
+
+private:
+    int insertNode(float x, float y, int id);
+    int buildBalanced(std::vector<int>& order, int begin, int end, int depth);
+
+    // node storage, one entry per inserted source
+    std::vector<float> nodeX;
+    std::vector<float> nodeY;
+    std::vector<int> nodeId;
+    std::vector<int> left;
+    std::vector<int> right;
+    std::vector<unsigned char> axis;  // 0 splits on x, 1 splits on y
+    std::vector<unsigned char> dead;
+
+    std::vector<int> idToNode;         // -1 if the id is not in the tree
+    int root;
+    int nLive;
+    int nDead;
+    int maxDepth;
+};
+
+#endif /* INC_SOURCEKDTREE_H_ */
@@ -0,0 +1,348 @@
+/**
+    Copyright 2017 Nanoleaf Ltd.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http:www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+    AuroraPlugin.cpp
+
+    Description:
+    Beat Detection and FFT to light source color based on FrequncyStars by Nathan Dyck.
+    A stain glass effect where the glass is cut by the music: every panel takes the colour of the nearest
+    live light source, so the sources split the layout into Voronoi cells. Each beat drops a new source
+    somewhere on the layout which steals the panels around it, and sources fade out and die after a while,
+    handing their panels to their neighbours. With no sources alive the static StainGlass colours show.
+ */
+
+
+#include "AuroraPlugin.h"
+#include "LayoutProcessingUtils.h"
+#include "ColorUtils.h"
+#include "DataManager.h"
+#include <stdlib.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "Logger.h"
+#include "PluginFeatures.h"
+#include "SourceKdTree.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    void initPlugin();
+    void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime);
+    void pluginCleanup();
+
+#ifdef __cplusplus
+}
+#endif
+
+#define MAX_PALETTE_COLOURS 7   // if more colours then this, we will use just the first this many
+#define MAX_SOURCES 512   // maxiumum live sources; when full the oldest source is removed
+#define ADJACENT_PANEL_DISTANCE 86.599995   // hard coded distance between adjacent panels; this ideally should be autodetected
+#define TRANSITION_TIME 1  // the transition time to send to panels; set to 100ms currently
+#define MINIMUM_INTENSITY 0.2  // the minimum intensity of a source
+#define TRIGGER_THRESHOLD 0.7 // used to calculate whether to add a source
+#define LIFESPAN 40 //the number of frames a source lives
+#define SPAWN_JITTER 0.5 //sources are spawned up to this many panel distances away from a panel centre
+#define BACKGROUND_DIVISOR 3 //the stain glass background is shown at 1/3 brightness, like StainGlass
+
+// Here we store the information accociated with each light source. Sources live in fixed slots so
+// that the slot index can be used as the id in the kd-tree.
+typedef struct {
+    float x;
+    float y;
+    int R;
+    int G;
+    int B;
+    int age;
+    bool alive;
+} source_t;
+
+/** Here we store the information accociated with each frequency bin. This
+ allows for tracking a degree of historical information.
+ */
+typedef struct {
+    uint32_t latest_minimum;
+    uint32_t soundPower;
+    int16_t colour;
+    uint32_t runningMax;
+    uint32_t runningMin;
+    uint32_t maximumTrigger;
+    uint32_t previousPower;
+    uint32_t secondPreviousPower;
+} freq_bin;
+
+static RGB_t* paletteColours = NULL; // this is our saved pointer to the colour palette
+static int nColours = 0;             // the number of colours in the palette
+static LayoutData *layoutData; // this is our saved pointer to the panel layout information
+static source_t sources[MAX_SOURCES]; // this is our array of source slots
+static int nSources = 0;
+static int oldestSource = 0; // slots are handed out round robin, so this is also the next slot to use
+static SourceKdTree sourceTree(MAX_SOURCES);
+static int* panelOwner = NULL; // the source that owned each panel last frame, used to warm start the search
+static RGB_t* frameColors = NULL; // the stain glass background
+static freq_bin freq_bins[MAX_PALETTE_COLOURS]; // this is our array for frequency bin historical information.
+static int warmupFrames = 0; // frames skipped so far, see SKIP_COUNT
+
+/**
+  * @description: add a value to a running max.
+  * @param: runningMax is current runningMax, valueToAdd is added to runningMax, effectiveTrail
+  *         defines how many values are effectively tracked. Note this is an approximation.
+  * @return: int returned as new runningMax.
+  */
+int addToRunningMax(int runningMax, int valueToAdd, int effectiveTrail) {
+    int trail = effectiveTrail;
+    if (valueToAdd > runningMax && effectiveTrail > 1) {
+        trail = trail / 2;
+    }
+    return runningMax - ((float)runningMax / effectiveTrail) + ((float)valueToAdd / trail);
+}
+
+/**
+ * @description: Initialize the plugin. Called once, when the plugin is loaded.
+ * This function can be used to load the LayoutData and the colorPalette from the DataManager.
+ * Any allocation, if done here, should be deallocated in the plugin cleanup function
+ *
+ */
+void initPlugin() {
+    getColorPalette(&paletteColours, &nColours);  // grab the palette colours and store a pointer to them for later use
+    PRINTLOG("The palette has %d colours:\n", nColours);
+    if(nColours > MAX_PALETTE_COLOURS) {
+        PRINTLOG("There are too many colours in the palette. using only the first %d\n", MAX_PALETTE_COLOURS);
+        nColours = MAX_PALETTE_COLOURS;
+    }
+
+    for (int i = 0; i < nColours; i++) {
+        PRINTLOG("   %d %d %d\n", paletteColours[i].R, paletteColours[i].G, paletteColours[i].B);
+    }
+
+    layoutData = getLayoutData(); // grab the layout data and store a pointer to it for later use
+
+    PRINTLOG("The layout has %d panels:\n", layoutData->nPanels);
+    for (int i = 0; i < layoutData->nPanels; i++) {
+        PRINTLOG("   Id: %d   X, Y: %lf, %lf\n", layoutData->panels[i].panelId,
+               layoutData->panels[i].shape->getCentroid().x, layoutData->panels[i].shape->getCentroid().y);
+    }
+
+    frameColors = new RGB_t[layoutData->nPanels];
+    panelOwner = new int[layoutData->nPanels];
+    for(int i = 0; i < layoutData->nPanels; i++) {
+        int color = drand48() * nColours;
+        frameColors[i] = paletteColours[color] / BACKGROUND_DIVISOR;
+        panelOwner[i] = -1;
+    }
+
+    // here we initialize our freqency bin values so that the plugin starts working reasonably well right away
+    for (int i = 0; i < nColours; i++) {
+        freq_bins[i].latest_minimum = 0;
+        freq_bins[i].runningMax = 3;
+        freq_bins[i].maximumTrigger = 1;
+    }
+    enableFft(nColours);
+    enableBeatFeatures();
+}
+
+/** Removes the light source in the given slot */
+void removeSource(int idx)
+{
+    if(!sources[idx].alive) {
+        return;
+    }
+    sources[idx].alive = false;
+    sourceTree.remove(idx);
+    nSources--;
+}
+
+/**
+  * @description: Adds a light source near the centre of a random panel. The new source takes over the
+  * panels that are closer to it than to any other source.
+*/
+void addSource(int paletteIndex, float intensity)
+{
+    if(layoutData->nPanels < 1) {
+        return;
+    }
+    int n1 = drand48() * layoutData->nPanels;
+    float x = layoutData->panels[n1].shape->getCentroid().x + (drand48() - 0.5) * 2 * SPAWN_JITTER * ADJACENT_PANEL_DISTANCE;
+    float y = layoutData->panels[n1].shape->getCentroid().y + (drand48() - 0.5) * 2 * SPAWN_JITTER * ADJACENT_PANEL_DISTANCE;
+
+    // slots are reused round robin, so the slot we take is the oldest one
+    int idx = oldestSource;
+    oldestSource = (oldestSource + 1) % MAX_SOURCES;
+    removeSource(idx);
+
+    sources[idx].x = x;
+    sources[idx].y = y;
+    sources[idx].R = paletteColours[paletteIndex].R * intensity;
+    sources[idx].G = paletteColours[paletteIndex].G * intensity;
+    sources[idx].B = paletteColours[paletteIndex].B * intensity;
+    sources[idx].age = 0;
+    sources[idx].alive = true;
+    sourceTree.insert(x, y, idx);
+    nSources++;
+}
+
+/**
+  * @description: This function will render the colour of the given single panel: the colour of the
+  * nearest source, faded by the age of that source.
+  */
+RGB_t renderPanel(int panelIndex)
+{
+    if(nSources == 0) {
+        panelOwner[panelIndex] = -1;
+        return frameColors[panelIndex];
+    }
+    const Point &centroid = layoutData->panels[panelIndex].shape->getCentroid();
+    int owner = sourceTree.nearest(centroid.x, centroid.y, panelOwner[panelIndex]);
+    panelOwner[panelIndex] = owner;
+
+    float life = 1.0 - (float)sources[owner].age / LIFESPAN;
+    RGB_t color;
+    color.R = sources[owner].R * life + frameColors[panelIndex].R * (1.0 - life);
+    color.G = sources[owner].G * life + frameColors[panelIndex].G * (1.0 - life);
+    color.B = sources[owner].B * life + frameColors[panelIndex].B * (1.0 - life);
+    return color;
+}
+
+/**
+  * A simple algorithm to detect beats. It finds a strong signal after a period of quietness.
+  * Actually, it doesn't detect just beats. For example, classical music often doesn't have
+  * strong beats but it has strong instrumental sections. Those would also get detected.
+  */
+int16_t beat_detector(int i)
+{
+    int16_t beat_detected = 0;
+
+    //Check for local maximum and if observed, add to running average
+    if((freq_bins[i].soundPower + (freq_bins[i].runningMax / 4) < freq_bins[i].previousPower) && (freq_bins[i].previousPower > freq_bins[i].secondPreviousPower)){
+        freq_bins[i].runningMax = addToRunningMax(freq_bins[i].runningMax, freq_bins[i].previousPower, 4);
+    }
+
+    // update latest minimum.
+    if(freq_bins[i].soundPower < freq_bins[i].latest_minimum) {
+        freq_bins[i].latest_minimum = freq_bins[i].soundPower;
+    }
+    else if(freq_bins[i].latest_minimum > 0) {
+        freq_bins[i].latest_minimum--;
+    }
+
+    // criteria for a "beat"; value must exceed minimum plus a threshold of the runningMax.
+    if(freq_bins[i].soundPower > freq_bins[i].latest_minimum + (freq_bins[i].runningMax * TRIGGER_THRESHOLD)) {
+        freq_bins[i].latest_minimum = freq_bins[i].soundPower;
+        beat_detected = 1;
+    }
+
+    // update historical information
+    freq_bins[i].secondPreviousPower = freq_bins[i].previousPower;
+    freq_bins[i].previousPower = freq_bins[i].soundPower;
+
+    return beat_detected;
+}
+
+/**
+ * @description: this the 'main' function that gives a frame to the Aurora to display onto the panels
+ * If the plugin is a sound visualization plugin, the sleepTime variable will be NULL and is not required to be
+ * filled in
+ * This function, if is an effects plugin, can specify the interval it is to be called at through the sleepTime variable
+ * if its a sound visualization plugin, this function is called at an interval of 50ms or more.
+ *
+ * @param frames: a pre-allocated buffer of the Frame_t structure to fill up with RGB values to show on panels.
+ * Maximum size of this buffer is equal to the number of panels
+ * @param nFrames: fill with the number of frames in frames
+ * @param sleepTime: specify interval after which this function is called again, NULL if sound visualization plugin
+ */
+void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime) {
+    int i;
+    uint8_t * fftBins = getFftBins();
+
+#define SKIP_COUNT 50
+    if (warmupFrames < SKIP_COUNT){
+        warmupFrames++;
+        return;
+    }
+
+    // Compute the sound power (or volume) in each bin
+    for(i = 0; i < nColours; i++) {
+        freq_bins[i].soundPower = fftBins[i];
+        uint8_t beat_detected = beat_detector(i);
+
+        if(beat_detected) {
+            if (freq_bins[i].soundPower > freq_bins[i].maximumTrigger) {
+                freq_bins[i].maximumTrigger = freq_bins[i].soundPower;
+            }
+
+            float intensity = 1.0;
+
+            //calculate an intensity ranging from minimum to 1, using log scale
+            if (freq_bins[i].soundPower > 1 && freq_bins[i].runningMax > 1){
+                intensity = ((log((float)freq_bins[i].soundPower) / log((float)freq_bins[i].runningMax)) * (1.0 - MINIMUM_INTENSITY)) + MINIMUM_INTENSITY;
+            }
+
+            if (intensity > 1.0) {
+                intensity = 1.0;
+            }
+
+            // add a new light source for each beat detected
+            addSource(i, intensity);
+        }
+    }
+    sourceTree.maintain();
+
+    // iterate through all the panels and render each one
+    for(i = 0; i < layoutData->nPanels; i++) {
+        RGB_t color = renderPanel(i);
+        frames[i].panelId = layoutData->panels[i].panelId;
+        frames[i].r = color.R;
+        frames[i].g = color.G;
+        frames[i].b = color.B;
+        frames[i].transTime = TRANSITION_TIME;
+    }
+
+    // age the sources and let the old ones die, their panels go to the neighbouring cells next frame
+    for(i = 0; i < MAX_SOURCES; i++) {
+        if(!sources[i].alive) {
+            continue;
+        }
+        sources[i].age++;
+        if(sources[i].age >= LIFESPAN) {
+            removeSource(i);
+        }
+    }
+
+    // this algorithm renders every panel at every frame
+    *nFrames = layoutData->nPanels;
+}
+
+/**
+ * @description: called once when the plugin is being closed.
+ * Do all deallocation for memory allocated in initplugin here
+ */
+void pluginCleanup() {
+    delete [] frameColors;
+    frameColors = NULL;
+    delete [] panelOwner;
+    panelOwner = NULL;
+    // no source may outlive the plugin, in its slot or in the tree
+    memset(sources, 0, sizeof(sources));
+    nSources = 0;
+    oldestSource = 0;
+    sourceTree.clear();
+    memset(freq_bins, 0, sizeof(freq_bins));
+    warmupFrames = 0;
+    layoutData = NULL;
+    paletteColours = NULL;
+    nColours = 0;
+}
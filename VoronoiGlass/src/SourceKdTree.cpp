@@ -0,0 +1,182 @@
+/*
+ * SourceKdTree.cpp
+ *
+ *  Description:
+ *  Incremental kd-tree for nearest source queries, see SourceKdTree.h.
+ */
+
+#include "SourceKdTree.h"
+#include <algorithm>
+#include <math.h>
+
+#define KDTREE_MAX_STACK 128
+
+SourceKdTree::SourceKdTree(int maxIds) : idToNode(maxIds, -1) {
+    root = -1;
+    nLive = 0;
+    nDead = 0;
+    maxDepth = 0;
+}
+
+void SourceKdTree::clear() {
+    nodeX.clear();
+    nodeY.clear();
+    nodeId.clear();
+    left.clear();
+    right.clear();
+    axis.clear();
+    dead.clear();
+    std::fill(idToNode.begin(), idToNode.end(), -1);
+    root = -1;
+    nLive = 0;
+    nDead = 0;
+    maxDepth = 0;
+}
+
+int SourceKdTree::insertNode(float x, float y, int id) {
+    int n = nodeX.size();
+    nodeX.push_back(x);
+    nodeY.push_back(y);
+    nodeId.push_back(id);
+    left.push_back(-1);
+    right.push_back(-1);
+    axis.push_back(0);
+    dead.push_back(0);
+    idToNode[id] = n;
+    nLive++;
+    return n;
+}
+
+void SourceKdTree::insert(float x, float y, int id) {
+    if(idToNode[id] >= 0) {
+        remove(id);
+    }
+    int n = insertNode(x, y, id);
+    if(root < 0) {
+        root = n;
+        return;
+    }
+    // walk down to the leaf the point falls into and hang the new node below it
+    int cur = root;
+    int depth = 1;
+    while(true) {
+        bool goLeft = axis[cur] == 0 ? x < nodeX[cur] : y < nodeY[cur];
+        int &next = goLeft ? left[cur] : right[cur];
+        if(next < 0) {
+            next = n;
+            axis[n] = 1 - axis[cur];
+            break;
+        }
+        cur = next;
+        depth++;
+    }
+    maxDepth = std::max(maxDepth, depth);
+}
+
+void SourceKdTree::remove(int id) {
+    int n = idToNode[id];
+    if(n < 0) {
+        return;
+    }
+    dead[n] = 1;
+    idToNode[id] = -1;
+    nLive--;
+    nDead++;
+}
+
+int SourceKdTree::nearest(float x, float y, int hint) const {
+    if(nLive == 0) {
+        return -1;
+    }
+    int best = -1;
+    float bestD2 = INFINITY;
+    // warm start: the hint gives a tight bound before we even look at the tree
+    if(hint >= 0 && hint < (int)idToNode.size() && idToNode[hint] >= 0) {
+        int n = idToNode[hint];
+        float dx = nodeX[n] - x;
+        float dy = nodeY[n] - y;
+        best = hint;
+        bestD2 = dx * dx + dy * dy;
+    }
+
+    int stack[KDTREE_MAX_STACK];
+    int top = 0;
+    stack[top++] = root;
+    while(top > 0) {
+        int n = stack[--top];
+        float dx = nodeX[n] - x;
+        float dy = nodeY[n] - y;
+        if(!dead[n]) {
+            float d2 = dx * dx + dy * dy;
+            if(d2 < bestD2) {
+                bestD2 = d2;
+                best = nodeId[n];
+            }
+        }
+        float diff = axis[n] == 0 ? -dx : -dy;  // signed distance from the split plane to the query
+        int nearSide = diff < 0 ? left[n] : right[n];
+        int farSide = diff < 0 ? right[n] : left[n];
+        // the far side can only hold something closer if the split plane is within the current best radius
+        if(farSide >= 0 && diff * diff < bestD2 && top < KDTREE_MAX_STACK) {
+            stack[top++] = farSide;
+        }
+        if(nearSide >= 0 && top < KDTREE_MAX_STACK) {
+            stack[top++] = nearSide;
+        }
+    }
+    return best;
+}
+
+int SourceKdTree::buildBalanced(std::vector<int>& order, int begin, int end, int depth) {
+    if(begin >= end) {
+        return -1;
+    }
+    int a = depth & 1;
+    int mid = (begin + end) / 2;
+    const std::vector<float> &key = a == 0 ? nodeX : nodeY;
+    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                     [&key](int l, int r) { return key[l] < key[r]; });
+    int n = order[mid];
+    axis[n] = a;
+    left[n] = buildBalanced(order, begin, mid, depth + 1);
+    right[n] = buildBalanced(order, mid + 1, end, depth + 1);
+    maxDepth = std::max(maxDepth, depth);
+    return n;
+}
+
+void SourceKdTree::maintain() {
+    // a balanced tree of n nodes is log2(n) deep, allow some slack before paying for a rebuild
+    int depthLimit = 2 * (int)ceil(log2(nLive + 1)) + 4;
+    if(nDead <= nLive && maxDepth <= depthLimit) {
+        return;
+    }
+
+    // compact the live nodes to the front of the arrays and rebuild over them
+    int nNodes = nodeX.size();
+    int live = 0;
+    for(int n = 0; n < nNodes; n++) {
+        if(dead[n]) {
+            continue;
+        }
+        nodeX[live] = nodeX[n];
+        nodeY[live] = nodeY[n];
+        nodeId[live] = nodeId[n];
+        idToNode[nodeId[n]] = live;
+        live++;
+    }
+    nodeX.resize(live);
+    nodeY.resize(live);
+    nodeId.resize(live);
+    left.assign(live, -1);
+    right.assign(live, -1);
+    axis.assign(live, 0);
+    dead.assign(live, 0);
+    nDead = 0;
+    maxDepth = 0;
+
+    std::vector<int> order(live);
+    for(int n = 0; n < live; n++) {
+        order[n] = n;
+    }
+    root = buildBalanced(order, 0, live, 0);
+}
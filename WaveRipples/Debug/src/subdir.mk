@@ -0,0 +1,36 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+CPP_SRCS += \
+../src/AuroraPlugin.cpp \
+../src/PanelGeometry.cpp \
+../src/PanelGraph.cpp \
+../src/PanelOrder.cpp \
+../src/WaveField.cpp 
+
+OBJS += \
+./src/AuroraPlugin.o \
+./src/PanelGeometry.o \
+./src/PanelGraph.o \
+./src/PanelOrder.o \
+./src/WaveField.o 
+
+CPP_DEPS += \
+./src/AuroraPlugin.d \
+./src/PanelGeometry.d \
+./src/PanelGraph.d \
+./src/PanelOrder.d \
+./src/WaveField.d 
+
+
+# Each subdirectory must supply rules for building sources it contributes
+src/%.o: ../src/%.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	g++ -I../inc -O0 -g3 -Wall -c -fmessage-length=0 -std=c++11 -fPIC -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+
@@ -0,0 +1,42 @@
+/*
+ * PanelOrder.h
+ *
+ *  Description:
+ *  The controller hands us the panels in no particular order. PanelOrder flattens the layout into
+ *  contiguous arrays sorted along a Hilbert curve through the panel centroids, so panels that are close
+ *  on the wall are also close in memory. Anything indexed by panel (distance tables, grids, neighbour
+ *  lists) should be indexed by this order; panelId[] maps back to the id that goes into Frame_t.
+ */
+
+#ifndef INC_PANELORDER_H_
+#define INC_PANELORDER_H_
+
+#include "LayoutProcessingUtils.h"
+#include <stdint.h>
+#include <vector>
+
+#define HILBERT_ORDER 16   // the centroids are quantized onto a 2^16 x 2^16 grid before walking the curve
+
+class PanelOrder {
+public:
+    PanelOrder();
+
+    /**
+     * @description: sort the panels of the layout along the Hilbert curve and flatten them into arrays
+     * @param layoutData: the layout to process
+     */
+    void build(LayoutData* layoutData);
+
+    int nPanels;
+    std::vector<float> x;            // centroid x, in curve order
+    std::vector<float> y;            // centroid y, in curve order
+    std::vector<int> panelId;        // panelId to write into Frame_t, in curve order
+    std::vector<int> layoutIndex;    // index into layoutData->panels, in curve order
+};
+
+/**
+ * @description: position of the grid point (x, y) along a Hilbert curve filling a 2^order x 2^order grid
+ */
+uint64_t hilbertIndex(uint32_t x, uint32_t y, int order);
+
+#endif /* INC_PANELORDER_H_ */
@@ -0,0 +1,59 @@
+/*
+ * WaveField.h
+ *
+ *  Description:
+ *  Damped wave equation on the panel adjacency graph. Every panel holds a height per colour channel; each
+ *  step moves every height towards the mean of its neighbours (the graph Laplacian) with momentum:
+ *
+ *      next = (2 * current - previous + speed2 * sum over neighbours (neighbour - current)) * damping
+ *
+ *  The heights are stored as separate arrays per channel (R, G and B) in PanelOrder order, and previous and
+ *  next share one buffer, since next[i] only depends on previous[i]. A step is a single sweep over the CSR
+ *  neighbour lists, so its cost is O(edges) no matter how many impulses are travelling around.
+ */
+
+#ifndef INC_WAVEFIELD_H_
+#define INC_WAVEFIELD_H_
+
+#include "PanelGraph.h"
+#include <vector>
+
+#define WAVE_CHANNELS 3
+
+class WaveField {
+public:
+    WaveField();
+
+    /**
+     * @description: size the height fields for the graph and set them flat
+     * @param graph: the panel adjacency, must outlive the wave field
+     */
+    void init(const PanelGraph* graph);
+
+    /**
+     * @description: kick the surface at one panel, e.g. on a beat
+     * @param panel: the panel index (PanelOrder order)
+     * @param R, G, B: the height added to each channel
+     */
+    void impulse(int panel, float R, float G, float B);
+
+    /**
+     * @description: advance the simulation
+     * @param substeps: number of steps to take
+     * @param speed2: squared wave speed, in panels per step. Capped at 2 / the most neighbours any panel has
+     * (2/3 for triangles, 1/2 for squares, 1/3 for hexagons), beyond that the waves blow up
+     * @param damping: factor applied to the heights every step, slightly below 1
+     */
+    void step(int substeps, float speed2, float damping);
+
+    /** @description: height of channel c at a panel */
+    float height(int c, int panel) const { return current[c][panel]; }
+
+private:
+    const PanelGraph* graph;
+    int maxDegree;              // most neighbours of any panel, at least 1
+    std::vector<float> current[WAVE_CHANNELS];
+    std::vector<float> previous[WAVE_CHANNELS];  // overwritten with the next heights during a step, then swapped
+};
+
+#endif /* INC_WAVEFIELD_H_ */
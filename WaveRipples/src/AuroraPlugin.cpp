@@ -0,0 +1,278 @@
+/**
+    Copyright 2017 Nanoleaf Ltd.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+    http:www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+
+    AuroraPlugin.cpp
+
+    Description:
+    Beat Detection and FFT to light source color based on FrequncyStars by Nathan Dyck.
+    Ripples that travel over the panels like waves on water. A beat kicks the surface at a random panel
+    with the colour of its frequency band, and a damped wave equation spreads the kick to the neighbouring
+    panels, so ripples follow the shape of the layout, bounce off its edges and run through each other.
+    The cost per frame depends only on the size of the layout, not on how many beats are in flight.
+ */
+
+
+#include "AuroraPlugin.h"
+#include "LayoutProcessingUtils.h"
+#include "ColorUtils.h"
+#include "DataManager.h"
+#include <stdlib.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "Logger.h"
+#include "PluginFeatures.h"
+#include "PanelOrder.h"
+#include "PanelGraph.h"
+#include "WaveField.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    void initPlugin();
+    void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime);
+    void pluginCleanup();
+
+#ifdef __cplusplus
+}
+#endif
+
+#define MAX_PALETTE_COLOURS 7   // if more colours then this, we will use just the first this many
+#define TRANSITION_TIME 1  // the transition time to send to panels; set to 100ms currently
+#define MINIMUM_INTENSITY 0.2  // the minimum intensity of a source
+#define TRIGGER_THRESHOLD 0.7 // used to calculate whether to add a source
+//Wave consts
+#define WAVE_SUBSTEPS 4 //simulation steps per frame, more steps make the ripples travel further per frame
+#define WAVE_SPEED2 0.3 //squared wave speed; WaveField caps it at 2 / most neighbours a panel has (2/3 triangles, 1/2 squares, 1/3 hexagons), beyond that the waves blow up
+#define WAVE_DAMPING 0.97 //how much of the wave survives each step
+#define WAVE_IMPULSE_GAIN 2.0 //height of a beat's kick relative to its colour
+
+/** Here we store the information accociated with each frequency bin. This
+ allows for tracking a degree of historical information.
+ */
+typedef struct {
+    uint32_t latest_minimum;
+    uint32_t soundPower;
+    int16_t colour;
+    uint32_t runningMax;
+    uint32_t runningMin;
+    uint32_t maximumTrigger;
+    uint32_t previousPower;
+    uint32_t secondPreviousPower;
+} freq_bin;
+
+static RGB_t* paletteColours = NULL; // this is our saved pointer to the colour palette
+static int nColours = 0;             // the number of colours in the palette
+static LayoutData *layoutData; // this is our saved pointer to the panel layout information
+static PanelOrder panelOrder; // the layout flattened into arrays in Hilbert curve order
+static PanelGeometry panelGeometry; // the panel shapes, bucketed by shape type
+static PanelGraph panelGraph; // which panels touch which
+static WaveField waves; // the wave heights on every panel
+static freq_bin freq_bins[MAX_PALETTE_COLOURS]; // this is our array for frequency bin historical information.
+static int warmupFrames = 0; // frames skipped so far, see SKIP_COUNT
+
+/**
+  * @description: add a value to a running max.
+  * @param: runningMax is current runningMax, valueToAdd is added to runningMax, effectiveTrail
+  *         defines how many values are effectively tracked. Note this is an approximation.
+  * @return: int returned as new runningMax.
+  */
+int addToRunningMax(int runningMax, int valueToAdd, int effectiveTrail) {
+    int trail = effectiveTrail;
+    if (valueToAdd > runningMax && effectiveTrail > 1) {
+        trail = trail / 2;
+    }
+    return runningMax - ((float)runningMax / effectiveTrail) + ((float)valueToAdd / trail);
+}
+
+/**
+ * @description: Initialize the plugin. Called once, when the plugin is loaded.
+ * This function can be used to load the LayoutData and the colorPalette from the DataManager.
+ * Any allocation, if done here, should be deallocated in the plugin cleanup function
+ *
+ */
+void initPlugin() {
+    getColorPalette(&paletteColours, &nColours);  // grab the palette colours and store a pointer to them for later use
+    PRINTLOG("The palette has %d colours:\n", nColours);
+    if(nColours > MAX_PALETTE_COLOURS) {
+        PRINTLOG("There are too many colours in the palette. using only the first %d\n", MAX_PALETTE_COLOURS);
+        nColours = MAX_PALETTE_COLOURS;
+    }
+
+    for (int i = 0; i < nColours; i++) {
+        PRINTLOG("   %d %d %d\n", paletteColours[i].R, paletteColours[i].G, paletteColours[i].B);
+    }
+
+    layoutData = getLayoutData(); // grab the layout data and store a pointer to it for later use
+
+    PRINTLOG("The layout has %d panels:\n", layoutData->nPanels);
+    for (int i = 0; i < layoutData->nPanels; i++) {
+        PRINTLOG("   Id: %d   X, Y: %lf, %lf\n", layoutData->panels[i].panelId,
+               layoutData->panels[i].shape->getCentroid().x, layoutData->panels[i].shape->getCentroid().y);
+    }
+
+    panelOrder.build(layoutData);
+    panelGeometry.build(layoutData);
+    panelGraph.build(panelOrder, panelGeometry);
+    waves.init(&panelGraph);
+    PRINTLOG("The layout has %d panel edges\n", (int)panelGraph.neighbours.size() / 2);
+
+    // here we initialize our freqency bin values so that the plugin starts working reasonably well right away
+    for (int i = 0; i < nColours; i++) {
+        freq_bins[i].latest_minimum = 0;
+        freq_bins[i].runningMax = 3;
+        freq_bins[i].maximumTrigger = 1;
+    }
+    enableFft(nColours);
+    enableBeatFeatures();
+}
+
+/**
+  * @description: Kicks the surface at a random panel with the colour of the given band.
+*/
+void addRipple(int paletteIndex, float intensity)
+{
+    if(panelOrder.nPanels < 1) {
+        return;
+    }
+    int n1 = drand48() * panelOrder.nPanels;
+    float gain = intensity * WAVE_IMPULSE_GAIN;
+    waves.impulse(n1, paletteColours[paletteIndex].R * gain, paletteColours[paletteIndex].G * gain,
+                  paletteColours[paletteIndex].B * gain);
+}
+
+/** Turns a wave height into a colour channel value; troughs light up as much as crests */
+int heightToChannel(float h)
+{
+    h = fabs(h);
+    return h > 255 ? 255 : (int)h;
+}
+
+/**
+  * A simple algorithm to detect beats. It finds a strong signal after a period of quietness.
+  * Actually, it doesn't detect just beats. For example, classical music often doesn't have
+  * strong beats but it has strong instrumental sections. Those would also get detected.
+  */
+int16_t beat_detector(int i)
+{
+    int16_t beat_detected = 0;
+
+    //Check for local maximum and if observed, add to running average
+    if((freq_bins[i].soundPower + (freq_bins[i].runningMax / 4) < freq_bins[i].previousPower) && (freq_bins[i].previousPower > freq_bins[i].secondPreviousPower)){
+        freq_bins[i].runningMax = addToRunningMax(freq_bins[i].runningMax, freq_bins[i].previousPower, 4);
+    }
+
+    // update latest minimum.
+    if(freq_bins[i].soundPower < freq_bins[i].latest_minimum) {
+        freq_bins[i].latest_minimum = freq_bins[i].soundPower;
+    }
+    else if(freq_bins[i].latest_minimum > 0) {
+        freq_bins[i].latest_minimum--;
+    }
+
+    // criteria for a "beat"; value must exceed minimum plus a threshold of the runningMax.
+    if(freq_bins[i].soundPower > freq_bins[i].latest_minimum + (freq_bins[i].runningMax * TRIGGER_THRESHOLD)) {
+        freq_bins[i].latest_minimum = freq_bins[i].soundPower;
+        beat_detected = 1;
+    }
+
+    // update historical information
+    freq_bins[i].secondPreviousPower = freq_bins[i].previousPower;
+    freq_bins[i].previousPower = freq_bins[i].soundPower;
+
+    return beat_detected;
+}
+
+/**
+ * @description: this the 'main' function that gives a frame to the Aurora to display onto the panels
+ * If the plugin is a sound visualization plugin, the sleepTime variable will be NULL and is not required to be
+ * filled in
+ * This function, if is an effects plugin, can specify the interval it is to be called at through the sleepTime variable
+ * if its a sound visualization plugin, this function is called at an interval of 50ms or more.
+ *
+ * @param frames: a pre-allocated buffer of the Frame_t structure to fill up with RGB values to show on panels.
+ * Maximum size of this buffer is equal to the number of panels
+ * @param nFrames: fill with the number of frames in frames
+ * @param sleepTime: specify interval after which this function is called again, NULL if sound visualization plugin
+ */
+void getPluginFrame(Frame_t* frames, int* nFrames, int* sleepTime) {
+    int i;
+    uint8_t * fftBins = getFftBins();
+
+#define SKIP_COUNT 50
+    if (warmupFrames < SKIP_COUNT){
+        warmupFrames++;
+        return;
+    }
+
+    // Compute the sound power (or volume) in each bin
+    for(i = 0; i < nColours; i++) {
+        freq_bins[i].soundPower = fftBins[i];
+        uint8_t beat_detected = beat_detector(i);
+
+        if(beat_detected) {
+            if (freq_bins[i].soundPower > freq_bins[i].maximumTrigger) {
+                freq_bins[i].maximumTrigger = freq_bins[i].soundPower;
+            }
+
+            float intensity = 1.0;
+
+            //calculate an intensity ranging from minimum to 1, using log scale
+            if (freq_bins[i].soundPower > 1 && freq_bins[i].runningMax > 1){
+                intensity = ((log((float)freq_bins[i].soundPower) / log((float)freq_bins[i].runningMax)) * (1.0 - MINIMUM_INTENSITY)) + MINIMUM_INTENSITY;
+            }
+
+            if (intensity > 1.0) {
+                intensity = 1.0;
+            }
+
+            // kick the surface for each beat detected
+            addRipple(i, intensity);
+        }
+    }
+
+    waves.step(WAVE_SUBSTEPS, WAVE_SPEED2, WAVE_DAMPING);
+
+    // every panel shows the wave height on it
+    for(i = 0; i < panelOrder.nPanels; i++) {
+        frames[i].panelId = panelOrder.panelId[i];
+        frames[i].r = heightToChannel(waves.height(0, i));
+        frames[i].g = heightToChannel(waves.height(1, i));
+        frames[i].b = heightToChannel(waves.height(2, i));
+        frames[i].transTime = TRANSITION_TIME;
+    }
+
+    // this algorithm renders every panel at every frame
+    *nFrames = panelOrder.nPanels;
+}
+
+/**
+ * @description: called once when the plugin is being closed.
+ * Do all deallocation for memory allocated in initplugin here
+ */
+void pluginCleanup() {
+    // hand back the tables and the wave planes, initPlugin builds them again
+    waves = WaveField();
+    panelOrder = PanelOrder();
+    panelGeometry = PanelGeometry();
+    panelGraph = PanelGraph();
+    memset(freq_bins, 0, sizeof(freq_bins));
+    warmupFrames = 0;
+    layoutData = NULL;
+    paletteColours = NULL;
+    nColours = 0;
+}
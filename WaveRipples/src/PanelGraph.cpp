@@ -0,0 +1,112 @@
+/*
+ * PanelGraph.cpp
+ *
+ *  Description:
+ *  Panel adjacency and hop distances, see PanelGraph.h.
+ */
+
+#include "PanelGraph.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+PanelGraph::PanelGraph() {
+    nPanels = 0;
+    frame = 0;
+}
+
+void PanelGraph::build(const PanelOrder& order, const PanelGeometry& geometry) {
+    nPanels = order.nPanels;
+    offsets.assign(nPanels + 1, 0);
+    neighbours.clear();
+    allPairs.clear();
+    cachedRows.clear();
+    cachedOrigin.clear();
+    cachedFrame.clear();
+    originSlot.assign(nPanels, -1);
+    queue.resize(nPanels);
+    if(nPanels == 0) {
+        return;
+    }
+
+    // the geometry finds shared sides in layout order, renumber them into PanelOrder positions
+    std::vector<std::vector<int> > touching;
+    geometry.adjacency(&touching);
+    std::vector<int> orderIndex(nPanels);
+    for(int i = 0; i < nPanels; i++) {
+        orderIndex[order.layoutIndex[i]] = i;
+    }
+    for(int i = 0; i < nPanels; i++) {
+        const std::vector<int>& list = touching[order.layoutIndex[i]];
+        for(size_t k = 0; k < list.size(); k++) {
+            neighbours.push_back(orderIndex[list[k]]);
+        }
+        std::sort(neighbours.begin() + offsets[i], neighbours.end());
+        offsets[i + 1] = neighbours.size();
+    }
+}
+
+void PanelGraph::buildHopDistances() {
+    if(nPanels <= GEODESIC_ALL_PAIRS_MAX) {
+        allPairs.resize((size_t)nPanels * nPanels);
+        for(int i = 0; i < nPanels; i++) {
+            fillRow(i, &allPairs[(size_t)i * nPanels]);
+        }
+    }
+}
+
+void PanelGraph::fillRow(int origin, uint8_t* out) {
+    // breadth first search, the hop count saturates at GEODESIC_UNREACHABLE
+    memset(out, GEODESIC_UNREACHABLE, nPanels);
+    int head = 0;
+    int tail = 0;
+    out[origin] = 0;
+    queue[tail++] = origin;
+    while(head < tail) {
+        int i = queue[head++];
+        if(out[i] >= GEODESIC_UNREACHABLE - 1) {
+            continue;
+        }
+        for(int k = offsets[i]; k < offsets[i + 1]; k++) {
+            int j = neighbours[k];
+            if(out[j] == GEODESIC_UNREACHABLE) {
+                out[j] = out[i] + 1;
+                queue[tail++] = j;
+            }
+        }
+    }
+    // everything further than the saturation point was never queued and stays GEODESIC_UNREACHABLE
+}
+
+void PanelGraph::beginFrame() {
+    frame++;
+}
+
+const uint8_t* PanelGraph::row(int origin) {
+    if(!allPairs.empty()) {
+        return &allPairs[(size_t)origin * nPanels];
+    }
+    int slot = originSlot[origin];
+    if(slot < 0) {
+        // recycle a row that was not used this frame, or grow the cache if every row is in use
+        for(int s = 0; s < (int)cachedRows.size(); s++) {
+            if(cachedFrame[s] != frame && (slot < 0 || cachedFrame[s] < cachedFrame[slot])) {
+                slot = s;
+            }
+        }
+        if(slot < 0) {
+            slot = cachedRows.size();
+            cachedRows.push_back(std::vector<uint8_t>(nPanels));
+            cachedOrigin.push_back(-1);
+            cachedFrame.push_back(frame);
+        }
+        if(cachedOrigin[slot] >= 0) {
+            originSlot[cachedOrigin[slot]] = -1;
+        }
+        fillRow(origin, &cachedRows[slot][0]);
+        cachedOrigin[slot] = origin;
+        originSlot[origin] = slot;
+    }
+    cachedFrame[slot] = frame;
+    return &cachedRows[slot][0];
+}
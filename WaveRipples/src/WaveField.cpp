@@ -0,0 +1,59 @@
+/*
+ * WaveField.cpp
+ *
+ *  Description:
+ *  Damped wave equation on the panel graph, see WaveField.h.
+ */
+
+#include "WaveField.h"
+#include <algorithm>
+
+WaveField::WaveField() {
+    graph = NULL;
+    maxDegree = 1;
+}
+
+void WaveField::init(const PanelGraph* panelGraph) {
+    graph = panelGraph;
+    for(int c = 0; c < WAVE_CHANNELS; c++) {
+        current[c].assign(graph->nPanels, 0);
+        previous[c].assign(graph->nPanels, 0);
+    }
+    maxDegree = 1;
+    for(int i = 0; i < graph->nPanels; i++) {
+        maxDegree = std::max(maxDegree, graph->offsets[i + 1] - graph->offsets[i]);
+    }
+}
+
+void WaveField::impulse(int panel, float R, float G, float B) {
+    // raising only the current height gives the panel a velocity as well, so the bump spreads outwards
+    current[0][panel] += R;
+    current[1][panel] += G;
+    current[2][panel] += B;
+}
+
+void WaveField::step(int substeps, float speed2, float damping) {
+    int n = graph->nPanels;
+    const int* offsets = graph->offsets.empty() ? NULL : &graph->offsets[0];
+    const int* neighbours = graph->neighbours.empty() ? NULL : &graph->neighbours[0];
+    if(n == 0) {
+        return;
+    }
+    // the stability limit of this scheme on the graph
+    speed2 = std::min(speed2, 2.0f / maxDegree);
+    for(int s = 0; s < substeps; s++) {
+        for(int c = 0; c < WAVE_CHANNELS; c++) {
+            const float* h = &current[c][0];
+            float* h2 = &previous[c][0];  // holds the previous heights going in, the next heights coming out
+            for(int i = 0; i < n; i++) {
+                float laplacian = 0;
+                for(int k = offsets[i]; k < offsets[i + 1]; k++) {
+                    laplacian += h[neighbours[k]];
+                }
+                laplacian -= (offsets[i + 1] - offsets[i]) * h[i];
+                h2[i] = (2 * h[i] - h2[i] + speed2 * laplacian) * damping;
+            }
+            current[c].swap(previous[c]);
+        }
+    }
+}